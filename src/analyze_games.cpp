@@ -0,0 +1,295 @@
+#include "analyze_games.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <unordered_set>
+
+#include "engine/engine.hpp"
+#include "engine/game_state.hpp"
+#include "engine/match.hpp"
+#include "engine/search_budget.hpp"
+#include "utils/command.hpp"
+#include "utils/error.hpp"
+#include "utils/json.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+using json::JsonValue;
+
+struct Move {
+  string guess;
+  string pattern;
+};
+
+// Each line is a game, the guesses alternating with the patterns they got.
+// Anything after a # is a comment.
+OrError<vector<vector<Move>>> read_games(istream& input, const string& name)
+{
+  vector<vector<Move>> games;
+  string line;
+  int line_number = 0;
+  while (getline(input, line)) {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    istringstream fields(line);
+    vector<string> words;
+    string word;
+    while (fields >> word) { words.push_back(word); }
+    if (words.empty()) continue;
+    if (words.size() % 2 != 0) {
+      return Error::format(
+        "$:$: expected guesses alternating with patterns", name, line_number);
+    }
+    vector<Move> game;
+    for (size_t i = 0; i < words.size(); i += 2) {
+      game.push_back(Move{.guess = words[i], .pattern = words[i + 1]});
+    }
+    games.push_back(move(game));
+  }
+  return games;
+}
+
+struct Analysis {
+  InternalString best_guess;
+  int num_guesses;
+  bool is_optimal;
+};
+
+OrError<Analysis> solve_state(
+  CachePair& cache_pair,
+  const GameState& game_state,
+  const WidthPolicy& width_policy,
+  int max_depth,
+  const optional<int>& time_limit_ms)
+{
+  Engine engine(cache_pair, false, width_policy);
+  if (time_limit_ms.has_value()) {
+    engine.set_budget(
+      SearchBudget::with_timeout(chrono::milliseconds(*time_limit_ms)));
+  }
+  optional<SearchResult> search;
+  for (int depth = 1; depth <= max_depth; ++depth) {
+    auto result = engine.search(game_state, depth);
+    // A depth cut off by the budget failed, the last one that finished is
+    // the answer and when none did the state has no answer
+    if (result.is_error()) {
+      if (engine.budget_exhausted() && search.has_value()) break;
+      return result.error();
+    }
+    search = result.value();
+    if (search->is_optimal) break;
+  }
+  return Analysis{
+    .best_guess = search->best_guess,
+    .num_guesses = search->num_guesses,
+    .is_optimal = search->is_optimal,
+  };
+}
+
+// A step is the state before a guess of a game, the states are kept once per
+// hash so that the steps of games that went the same way are solved once
+struct Step {
+  int state_idx;
+  string guess;
+  string pattern;
+  int num_secrets;
+};
+
+struct ReplayedGame {
+  vector<Step> steps;
+  // Why the game could not be replayed to the end
+  optional<Error> error;
+};
+
+OrError<Unit> analyze_games(
+  GameState initial_state,
+  const string& games_filename,
+  const string& output_filename,
+  const WidthPolicy& width_policy,
+  int max_depth,
+  const optional<int>& time_limit_ms,
+  int cache_max_size)
+{
+  vector<vector<Move>> games;
+  if (games_filename == "-") {
+    bail_assign(games, read_games(cin, "stdin"));
+  } else {
+    ifstream games_file(games_filename);
+    if (!games_file.is_open()) {
+      return Error::format("Failed to open games file $", games_filename);
+    }
+    bail_assign(games, read_games(games_file, games_filename));
+  }
+
+  ofstream output(output_filename);
+  if (!output.is_open()) {
+    return Error::format("Failed to open output file $", output_filename);
+  }
+
+  initial_state.sort_guesses_by_greedy(false);
+  unordered_set<string> words;
+  for (const auto w : initial_state.allowed_guesses()) {
+    words.insert(w.str());
+  }
+
+  vector<GameState> states;
+  map<string, int> state_indices;
+  vector<ReplayedGame> replayed(games.size());
+  int num_steps = 0;
+  for (size_t game_idx = 0; game_idx < games.size(); game_idx++) {
+    auto& game = replayed[game_idx];
+    GameState game_state = initial_state;
+    for (const auto& move : games[game_idx]) {
+      if (game_state.possible_secrets().empty()) {
+        game.error = Error("No possible secret is left");
+        break;
+      }
+      auto [it, inserted] =
+        state_indices.emplace(game_state.hash(), states.size());
+      if (inserted) { states.push_back(game_state); }
+      game.steps.push_back(Step{
+        .state_idx = it->second,
+        .guess = move.guess,
+        .pattern = move.pattern,
+        .num_secrets = int(game_state.possible_secrets().size()),
+      });
+      num_steps++;
+
+      if (words.count(move.guess) == 0) {
+        game.error = Error::format("Unknown word $", move.guess);
+        break;
+      }
+      auto match = Match::parse(move.pattern);
+      if (match.is_error()) {
+        game.error = match.error();
+        break;
+      }
+      if (match.value().is_all_hit()) {
+        const auto& secrets = game_state.possible_secrets();
+        if (
+          find(secrets.begin(), secrets.end(), InternalString(move.guess)) ==
+          secrets.end()) {
+          game.error =
+            Error::format("The word $ can't be the secret", move.guess);
+        }
+        break;
+      }
+      auto res =
+        game_state.make_guess(InternalString(move.guess), match.value());
+      if (res.is_error()) {
+        game.error = res.error();
+        break;
+      }
+    }
+  }
+  print_line(
+    "Replayed $ games, $ steps in $ unique states",
+    games.size(),
+    num_steps,
+    states.size());
+
+  // The biggest states first, their searches fill the cache with most of the
+  // smaller ones
+  vector<int> order(states.size());
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(), [&](int i1, int i2) {
+    return states[i1].possible_secrets().size() >
+           states[i2].possible_secrets().size();
+  });
+
+  auto cache_pair = make_unique<CachePair>(cache_max_size);
+  vector<optional<OrError<Analysis>>> analyses(states.size());
+  int num_done = 0;
+#pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i = 0; i < order.size(); i++) {
+    const int idx = order[i];
+    auto analysis = solve_state(
+      *cache_pair, states[idx], width_policy, max_depth, time_limit_ms);
+#pragma omp critical
+    {
+      analyses[idx] = move(analysis);
+      if (++num_done % 1000 == 0) {
+        print_line("Solved $/$ states", num_done, states.size());
+      }
+    }
+  }
+
+  int num_failed = 0;
+  for (size_t game_idx = 0; game_idx < replayed.size(); game_idx++) {
+    const auto& game = replayed[game_idx];
+    vector<JsonValue> steps;
+    for (const auto& step : game.steps) {
+      map<string, JsonValue> obj{
+        {"guess", json::to_json(step.guess)},
+        {"pattern", json::to_json(step.pattern)},
+        {"remaining_secrets", json::to_json(step.num_secrets)},
+      };
+      const auto& analysis = *analyses[step.state_idx];
+      if (analysis.is_error()) {
+        obj.emplace("error", json::to_json(analysis.error().msg()));
+      } else {
+        obj.emplace("best_guess", json::to_json(analysis.value().best_guess));
+        obj.emplace("num_guesses", json::to_json(analysis.value().num_guesses));
+        obj.emplace("is_optimal", json::to_json(analysis.value().is_optimal));
+      }
+      steps.push_back(json::to_json(obj));
+    }
+    map<string, JsonValue> obj{
+      {"game", json::to_json(int(game_idx))},
+      {"steps", json::to_json(steps)},
+    };
+    if (game.error.has_value()) {
+      obj.emplace("error", json::to_json(game.error->msg()));
+      num_failed++;
+    }
+    output << json::to_json(obj).to_string() << '\n';
+  }
+  output.close();
+  if (output.fail()) {
+    return Error::format("Failed to write $", output_filename);
+  }
+  if (num_failed > 0) {
+    print_line("$ games could not be replayed to the end", num_failed);
+  }
+  return unit;
+}
+
+} // namespace
+
+Command AnalyzeGames::command()
+{
+  auto builder = CommandBuilder(
+    "Find the best guess at every step of recorded games, solving each "
+    "distinct state once");
+  auto game_state_param = GameState::param(builder);
+  auto width_policy_param = WidthPolicy::param(builder);
+  auto games_file = builder.required("--games-file", string_flag);
+  auto output_file = builder.required("--output-file", string_flag);
+  auto max_depth = builder.optional_with_default("--max-depth", int_flag, 16);
+  auto time_limit_ms = builder.optional("--time-limit-ms", int_flag);
+  auto cache_max_size =
+    builder.optional_with_default("--cache-max-size", int_flag, 1 << 26);
+  return builder.run([=]() -> OrError<Unit> {
+    if (max_depth->value() < 1) {
+      return Error::format(
+        "Invalid --max-depth $, expected at least 1", max_depth->value());
+    }
+    bail(game_state, game_state_param());
+    return analyze_games(
+      move(game_state),
+      games_file->value(),
+      output_file->value(),
+      width_policy_param(),
+      max_depth->value(),
+      time_limit_ms->value(),
+      cache_max_size->value());
+  });
+}
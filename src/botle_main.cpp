@@ -1,6 +1,11 @@
 #include <iostream>
 
+#include "analyze_games.hpp"
 #include "evaluate.hpp"
+#include "evaluate_batch.hpp"
+#include "export_tree.hpp"
+#include "merge_solutions.hpp"
+#include "serve.hpp"
 #include "suggest.hpp"
 #include "utils/command.hpp"
 #include "word_counter.hpp"
@@ -10,6 +15,11 @@ int main(int argc, char* argv[])
   return CommandGroupBuilder()
     .cmd("suggest", Suggest::command())
     .cmd("evaluate", Evaluate::command())
+    .cmd("analyze-games", AnalyzeGames::command())
+    .cmd("evaluate-batch", EvaluateBatch::command())
+    .cmd("merge-solutions", MergeSolutions::command())
+    .cmd("serve", Serve::command())
+    .cmd("tree", ExportTree::command())
     .cmd("count-word", WordCounter::command())
     .build()
     .run(argc, argv);
@@ -0,0 +1,7 @@
+#include "build_id.hpp"
+
+#ifndef BOTLE_BUILD_ID
+#define BOTLE_BUILD_ID "unknown"
+#endif
+
+const char* build_id() { return BOTLE_BUILD_ID; }
@@ -0,0 +1,4 @@
+#pragma once
+
+// Changes whenever the code of botle does, see the Makefile
+const char* build_id();
@@ -0,0 +1,306 @@
+#include "avg_engine.hpp"
+
+#include "match.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+// Totals above this don't fit in the cache entries
+constexpr int max_cacheable_sum = numeric_limits<uint16_t>::max() - 1;
+
+int bucket_lower_bound(int size) { return size <= 1 ? size : 2 * size - 1; }
+
+int lower_bound_from_sizes(const array<int, 256>& sizes, int num_secrets)
+{
+  // Bucket 0 is the all hit pattern, that secret is already found
+  int total = num_secrets;
+  for (size_t i = 1; i < sizes.size(); i++) {
+    total += bucket_lower_bound(sizes[i]);
+  }
+  return total;
+}
+
+struct Bucket {
+  vector<InternalString> allowed_guesses;
+  vector<InternalString> possible_secrets;
+};
+
+} // namespace
+
+int total_guesses_lower_bound(
+  InternalString guess, const vector<InternalString>& possible_secrets)
+{
+  array<int, 256> sizes;
+  sizes.fill(0);
+  for (const auto secret : possible_secrets) {
+    sizes[Match::match(guess, secret).code()]++;
+  }
+  return lower_bound_from_sizes(sizes, possible_secrets.size());
+}
+
+int two_guesses_lower_bound(
+  InternalString guess,
+  const vector<InternalString>& allowed_guesses,
+  const vector<InternalString>& possible_secrets,
+  bool hard_mode)
+{
+  array<Bucket, 256> buckets;
+  for (const auto secret : possible_secrets) {
+    buckets[Match::match(guess, secret).code()].possible_secrets.push_back(
+      secret);
+  }
+  if (hard_mode) {
+    for (const auto allowed_guess : allowed_guesses) {
+      buckets[Match::match(guess, allowed_guess).code()]
+        .allowed_guesses.push_back(allowed_guess);
+    }
+  }
+
+  int total = possible_secrets.size();
+  for (size_t i = 1; i < buckets.size(); i++) {
+    const auto& b = buckets[i];
+    const int size = b.possible_secrets.size();
+    if (size <= 2) {
+      total += bucket_lower_bound(size);
+      continue;
+    }
+    int best = hard_mode && b.allowed_guesses.empty()
+                 ? bucket_lower_bound(size)
+                 : numeric_limits<int>::max();
+    for (const auto next_guess :
+         hard_mode ? b.allowed_guesses : allowed_guesses) {
+      best = min(best, total_guesses_lower_bound(next_guess, b.possible_secrets));
+      if (best == bucket_lower_bound(size)) break;
+    }
+    total += best;
+  }
+  return total;
+}
+
+AvgEngine::AvgEngine(Cache& cache, int width) : _cache(cache), _width(width)
+{}
+
+AvgEngine::~AvgEngine() {}
+
+unique_ptr<SearchEngine> AvgEngine::fork() const
+{
+  auto engine = make_unique<AvgEngine>(_cache, _width);
+  engine->set_budget(_budget);
+  return engine;
+}
+
+SearchResult AvgEngine::sum_search(
+  const vector<InternalString>& allowed_guesses,
+  const vector<InternalString>& possible_secrets,
+  const InternalString guess,
+  const int max_depth,
+  const int beta)
+{
+  array<Bucket, 256> buckets;
+  for (const auto possible_secret : possible_secrets) {
+    auto r = Match::match(guess, possible_secret);
+    buckets[r.code()].possible_secrets.push_back(possible_secret);
+  }
+  if (_hard_mode) {
+    for (const auto allowed_guess : allowed_guesses) {
+      auto r = Match::match(guess, allowed_guess);
+      buckets[r.code()].allowed_guesses.push_back(allowed_guess);
+    }
+  }
+
+  vector<int> order;
+  int remaining_lower_bound = 0;
+  for (int i = 1; i < 256; i++) {
+    int size = buckets[i].possible_secrets.size();
+    if (size == 0) continue;
+    remaining_lower_bound += bucket_lower_bound(size);
+    order.push_back(i);
+  }
+  sort(order.begin(), order.end(), [&](int b1, int b2) {
+    return buckets[b1].possible_secrets.size() >
+           buckets[b2].possible_secrets.size();
+  });
+
+  int total = possible_secrets.size();
+  bool is_optimal = true;
+  for (int idx : order) {
+    const auto& b = buckets[idx];
+    const int size = b.possible_secrets.size();
+    remaining_lower_bound -= bucket_lower_bound(size);
+    if (size == 1) {
+      total += 1;
+      continue;
+    }
+    auto res = min_search(
+      _hard_mode ? b.allowed_guesses : allowed_guesses,
+      b.possible_secrets,
+      max_depth - 1,
+      beta - total - remaining_lower_bound);
+    if (_budget.is_exhausted()) {
+      return SearchResult{
+        .best_guess = guess,
+        .num_guesses = beta,
+        .is_optimal = false,
+      };
+    }
+    total += res.num_guesses;
+    is_optimal = is_optimal && res.is_optimal;
+    if (total + remaining_lower_bound >= beta) {
+      return SearchResult{
+        .best_guess = guess,
+        .num_guesses = beta,
+        .is_optimal = is_optimal,
+      };
+    }
+  }
+
+  return SearchResult{
+    .best_guess = guess,
+    .num_guesses = total,
+    .is_optimal = is_optimal,
+  };
+}
+
+SearchResult AvgEngine::min_search(
+  const vector<InternalString>& allowed_guesses,
+  const vector<InternalString>& possible_secrets,
+  const int max_depth,
+  const int beta)
+{
+  assert(possible_secrets.size() > 0);
+
+  const int num_secrets = possible_secrets.size();
+  if (num_secrets <= 2) {
+    return SearchResult{
+      .best_guess = possible_secrets[0],
+      .num_guesses = 2 * num_secrets - 1,
+      .is_optimal = true,
+    };
+  }
+
+  // Not even guessing a secret that splits all the others can beat beta
+  if (beta <= 2 * num_secrets - 1) {
+    return SearchResult{
+      .best_guess = possible_secrets[0],
+      .num_guesses = beta,
+      .is_optimal = true,
+    };
+  }
+
+  CacheKey cache_key = _cache.min_search_key(possible_secrets);
+  {
+    auto cache_entry = _cache.find(max_depth, cache_key);
+    if (cache_entry.lower_bound >= beta) {
+      return SearchResult{
+        .best_guess = cache_entry.lower_bound_word,
+        .num_guesses = cache_entry.lower_bound,
+        .is_optimal = cache_entry.lower_bound_optimal,
+      };
+    }
+    if (
+      cache_entry.lower_bound == cache_entry.upper_bound &&
+      !cache_entry.upper_bound_word.is_empty()) {
+      return SearchResult{
+        .best_guess = cache_entry.upper_bound_word,
+        .num_guesses = cache_entry.upper_bound,
+        .is_optimal = cache_entry.upper_bound_optimal,
+      };
+    }
+  }
+
+  if (_budget.poll()) {
+    return SearchResult{
+      .best_guess = possible_secrets[0],
+      .num_guesses = beta,
+      .is_optimal = false,
+    };
+  }
+
+  // A guess that leaves every secret in the same bucket has this bound, it
+  // would just recurse on the same set.
+  const int useless_bound = 3 * num_secrets - 1;
+
+  vector<pair<int, InternalString>> sorted_candidates;
+  sorted_candidates.reserve(_width + 1);
+  int cutoff = min(beta, useless_bound);
+  for (const auto& guess_candidate : allowed_guesses) {
+    int lower_bound =
+      total_guesses_lower_bound(guess_candidate, possible_secrets);
+    if (lower_bound >= cutoff) continue;
+    sorted_candidates.emplace_back(lower_bound, guess_candidate);
+    push_heap(sorted_candidates.begin(), sorted_candidates.end());
+    if (int(sorted_candidates.size()) > _width) {
+      pop_heap(sorted_candidates.begin(), sorted_candidates.end());
+      cutoff = min(cutoff, sorted_candidates.back().first);
+      sorted_candidates.pop_back();
+    }
+  }
+  sort_heap(sorted_candidates.begin(), sorted_candidates.end());
+
+  SearchResult best{
+    .best_guess = InternalString(),
+    .num_guesses = beta,
+    .is_optimal = true,
+  };
+  for (const auto& candidate : sorted_candidates) {
+    // Candidates are sorted by their bound, none of the others can do better
+    if (candidate.first >= best.num_guesses) { break; }
+    if (max_depth <= 1) {
+      best = SearchResult{
+        .best_guess = candidate.second,
+        .num_guesses = candidate.first,
+        .is_optimal = false,
+      };
+      break;
+    }
+    auto res = sum_search(
+      allowed_guesses,
+      possible_secrets,
+      candidate.second,
+      max_depth,
+      best.num_guesses);
+    if (_budget.is_exhausted()) {
+      // Out of budget, the value of this candidate is unknown
+      if (best.best_guess.is_empty()) { best.best_guess = candidate.second; }
+      best.is_optimal = false;
+      break;
+    }
+    if (res.num_guesses < best.num_guesses) { best = res; }
+  }
+
+  if (best.num_guesses <= max_cacheable_sum && !_budget.is_exhausted()) {
+    _cache.update(
+      max_depth,
+      cache_key,
+      best.num_guesses,
+      0,
+      min(beta, max_cacheable_sum + 1),
+      best.best_guess,
+      best.is_optimal);
+  }
+
+  return best;
+}
+
+OrError<SearchResult> AvgEngine::search(
+  const GameStateView& game_state, int max_depth)
+{
+  assert(max_depth > 0);
+  _budget.check();
+  _hard_mode = game_state.is_hard_mode();
+  auto result = min_search(
+    game_state.allowed_guesses(),
+    game_state.possible_secrets(),
+    max_depth,
+    numeric_limits<int>::max());
+  if (_budget.is_exhausted()) { return Error("Search budget exhausted"); }
+  if (result.best_guess.is_empty()) {
+    return Error("Average engine failed to find a word");
+  }
+  return result;
+}
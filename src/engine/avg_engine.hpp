@@ -0,0 +1,56 @@
+#pragma once
+
+#include "cache.hpp"
+#include "search_engine.hpp"
+
+// Lower bound on the total number of guesses needed to find every possible
+// secret when starting with the given guess. Every secret costs the guess
+// itself, plus at least 1 more guess for a singleton bucket and at least 2k-1
+// more for a bucket with k secrets.
+int total_guesses_lower_bound(
+  InternalString guess, const std::vector<InternalString>& possible_secrets);
+
+// Tighter than total_guesses_lower_bound, each bucket with more than 2 secrets
+// is bounded by its best next guess instead. In hard mode the next guesses are
+// only the allowed guesses with the bucket's pattern, in easy mode it costs a
+// match of every allowed guess against every secret.
+int two_guesses_lower_bound(
+  InternalString guess,
+  const std::vector<InternalString>& allowed_guesses,
+  const std::vector<InternalString>& possible_secrets,
+  bool hard_mode);
+
+// Search engine that minimises the expected number of guesses, rather than the
+// worst case. It is a branch and bound over the same candidate lists as Engine,
+// with a bound on the sum of guesses over all possible secrets. The num_guesses
+// of its results is that sum, divide by the number of possible secrets to get
+// the average.
+struct AvgEngine : public SearchEngine {
+ public:
+  AvgEngine(Cache& cache, int width);
+
+  virtual ~AvgEngine();
+
+  virtual OrError<SearchResult> search(
+    const GameStateView& game_state, int max_depth);
+
+  virtual std::unique_ptr<SearchEngine> fork() const;
+
+ private:
+  Cache& _cache;
+  int _width;
+  bool _hard_mode;
+
+  SearchResult min_search(
+    const std::vector<InternalString>& allowed_guesses,
+    const std::vector<InternalString>& possible_secrets,
+    int max_depth,
+    int beta);
+
+  SearchResult sum_search(
+    const std::vector<InternalString>& allowed_guesses,
+    const std::vector<InternalString>& possible_secrets,
+    InternalString guess,
+    int max_depth,
+    int beta);
+};
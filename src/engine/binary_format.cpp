@@ -0,0 +1,33 @@
+#include "binary_format.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+void patch_u32_le(string& output, size_t pos, uint32_t value)
+{
+  for (size_t i = 0; i < 4; i++) {
+    output[pos + i] = char((value >> (8 * i)) & 0xff);
+  }
+}
+
+WordList binary_dictionary(const WordList& allowed_guesses)
+{
+  WordList dictionary = allowed_guesses;
+  sort(dictionary.begin(), dictionary.end(), [](auto w1, auto w2) {
+    return w1.str() < w2.str();
+  });
+  return dictionary;
+}
+
+OrError<vector<int>> binary_word_indices(const WordList& dictionary)
+{
+  if (dictionary.size() > 0xffff) {
+    return Error("Dictionary is too big for the binary format");
+  }
+  vector<int> indices(InternalString::max_id(), -1);
+  for (size_t i = 0; i < dictionary.size(); i++) {
+    indices.at(dictionary[i].id()) = i;
+  }
+  return indices;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "internal_string.hpp"
+#include "utils/error.hpp"
+
+// Helpers shared by the binary encodings of decision trees and solution
+// files. Integers are little endian and words are u16 indices into a
+// dictionary, the allowed guesses sorted alphabetically.
+
+template <class T> void write_le(std::string& output, T value)
+{
+  for (size_t i = 0; i < sizeof(T); i++) {
+    output += char((uint64_t(value) >> (8 * i)) & 0xff);
+  }
+}
+
+// Overwrites a u32 written earlier, for sizes only known after the fact
+void patch_u32_le(std::string& output, size_t pos, uint32_t value);
+
+template <class T> T read_le(const uint8_t* data)
+{
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    value |= uint64_t(data[i]) << (8 * i);
+  }
+  return T(value);
+}
+
+WordList binary_dictionary(const WordList& allowed_guesses);
+
+// Index of each word in the dictionary by its id, -1 for the others
+OrError<std::vector<int>> binary_word_indices(const WordList& dictionary);
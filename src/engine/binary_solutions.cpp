@@ -0,0 +1,288 @@
+#include "binary_solutions.hpp"
+
+#include "binary_format.hpp"
+
+#include <cmath>
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+const string binary_magic = "BSL1";
+
+constexpr size_t header_size = 4 + 4 + 2 + 2;
+constexpr size_t node_header_size = 2 + 2 + 1 + 1;
+constexpr size_t pattern_header_size = 1 + 4;
+
+// Returns the number of bytes taken by the node
+OrError<size_t> validate_node(
+  const uint8_t* data, size_t size, size_t dictionary_size)
+{
+  if (size < node_header_size) { return Error("Tree node is truncated"); }
+  if (read_le<uint16_t>(data) >= dictionary_size) {
+    return Error("Tree node has a word outside of the dictionary");
+  }
+  const int num_patterns = data[5];
+  size_t pos = node_header_size;
+  for (int i = 0; i < num_patterns; i++) {
+    if (size - pos < pattern_header_size) {
+      return Error("Tree pattern is truncated");
+    }
+    const size_t child_size = read_le<uint32_t>(data + pos + 1);
+    pos += pattern_header_size;
+    if (child_size > size - pos) { return Error("Tree child is truncated"); }
+    if (child_size > 0) {
+      bail(used, validate_node(data + pos, child_size, dictionary_size));
+      if (used != child_size) {
+        return Error("Tree child size doesn't match its contents");
+      }
+    }
+    pos += child_size;
+  }
+  return pos;
+}
+
+OrError<Unit> validate_solution(
+  const uint8_t* data, size_t size, size_t dictionary_size)
+{
+  constexpr size_t fixed_size = 2 + 4 + 1 + 1 + 1;
+  if (size < fixed_size) { return Error("Solution is truncated"); }
+  if (read_le<uint16_t>(data) >= dictionary_size) {
+    return Error("Solution has a word outside of the dictionary");
+  }
+  const size_t num_matches = data[8];
+  size_t pos = fixed_size + num_matches;
+  if (size < pos + 4) { return Error("Solution is truncated"); }
+  const size_t tree_size = read_le<uint32_t>(data + pos);
+  pos += 4;
+  if (tree_size != size - pos) {
+    return Error("Solution tree size doesn't match its contents");
+  }
+  if (tree_size > 0) {
+    bail(used, validate_node(data + pos, tree_size, dictionary_size));
+    if (used != tree_size) {
+      return Error("Solution tree size doesn't match its contents");
+    }
+  }
+  return unit;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// BinaryTreeNode
+//
+
+BinaryTreeNode::BinaryTreeNode(const uint8_t* data, const WordList* dictionary)
+    : _data(data), _dictionary(dictionary)
+{}
+
+InternalString BinaryTreeNode::guess() const
+{
+  return _dictionary->at(read_le<uint16_t>(_data));
+}
+
+int BinaryTreeNode::num_secrets() const { return read_le<uint16_t>(_data + 2); }
+
+int BinaryTreeNode::longest_path() const { return _data[4]; }
+
+vector<Match> BinaryTreeNode::patterns() const
+{
+  vector<Match> out;
+  const uint8_t* p = _data + node_header_size;
+  for (int i = 0; i < _data[5]; i++) {
+    out.emplace_back(p[0]);
+    p += pattern_header_size + read_le<uint32_t>(p + 1);
+  }
+  return out;
+}
+
+optional<BinaryTreeNode> BinaryTreeNode::child(Match match) const
+{
+  const uint8_t* p = _data + node_header_size;
+  for (int i = 0; i < _data[5]; i++) {
+    const uint32_t size = read_le<uint32_t>(p + 1);
+    if (p[0] == match.code()) {
+      if (size == 0) return nullopt;
+      return BinaryTreeNode(p + pattern_header_size, _dictionary);
+    }
+    p += pattern_header_size + size;
+  }
+  return nullopt;
+}
+
+int BinaryTreeNode::total_guesses() const
+{
+  // Every secret needs this node's guess, those below need their subtrees'
+  int total = num_secrets();
+  const uint8_t* p = _data + node_header_size;
+  for (int i = 0; i < _data[5]; i++) {
+    const uint32_t size = read_le<uint32_t>(p + 1);
+    if (size > 0) {
+      total +=
+        BinaryTreeNode(p + pattern_header_size, _dictionary).total_guesses();
+    }
+    p += pattern_header_size + size;
+  }
+  return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BinarySolutions
+//
+
+BinarySolutions::BinarySolutions(const uint8_t* data, WordList dictionary)
+    : _data(data),
+      _dictionary(make_shared<const WordList>(move(dictionary)))
+{}
+
+OrError<string> BinarySolutions::encode(
+  const vector<WordInfo>& solutions,
+  const map<InternalString, const DecisionTree*>& trees,
+  const WordList& dictionary,
+  int num_secrets)
+{
+  bail(indices, binary_word_indices(dictionary));
+  if (num_secrets > 0xffff || solutions.size() > 0xffff) {
+    return Error("Too many solutions for the binary format");
+  }
+
+  string output = binary_magic;
+  write_le<uint32_t>(output, dictionary.size());
+  write_le<uint16_t>(output, num_secrets);
+  write_le<uint16_t>(output, solutions.size());
+  for (const auto& info : solutions) {
+    const int index = indices.at(info.first_guess.id());
+    if (index < 0) {
+      return Error::format(
+        "Word $ is not in the dictionary", info.first_guess);
+    }
+    if (info.worst_num_guesses > 0xff || info.max_depth > 0xff) {
+      return Error("Solution is too deep for the binary format");
+    }
+
+    size_t size_pos = output.size();
+    write_le<uint32_t>(output, 0);
+    size_t start = output.size();
+    write_le<uint16_t>(output, index);
+    write_le<uint32_t>(output, lround(info.avg_guesses * num_secrets));
+    write_le<uint8_t>(output, info.worst_num_guesses);
+    write_le<uint8_t>(output, info.max_depth);
+    write_le<uint8_t>(output, info.all_matches.size());
+    for (const auto match : info.all_matches) {
+      write_le<uint8_t>(output, match.code());
+    }
+
+    size_t tree_size_pos = output.size();
+    write_le<uint32_t>(output, 0);
+    auto it = trees.find(info.first_guess);
+    if (it != trees.end()) {
+      size_t tree_start = output.size();
+      bail_unit(it->second->append_binary(indices, output));
+      patch_u32_le(output, tree_size_pos, output.size() - tree_start);
+    }
+    patch_u32_le(output, size_pos, output.size() - start);
+  }
+  return output;
+}
+
+OrError<BinarySolutions> BinarySolutions::of_buffer(
+  const uint8_t* data, size_t size, const WordList& dictionary)
+{
+  if (
+    size < header_size ||
+    string(reinterpret_cast<const char*>(data), 4) != binary_magic) {
+    return Error("Not a binary solutions file");
+  }
+  if (read_le<uint32_t>(data + 4) != dictionary.size()) {
+    return Error::format(
+      "Solutions were written for a dictionary of $ words, got $",
+      read_le<uint32_t>(data + 4),
+      dictionary.size());
+  }
+
+  BinarySolutions solutions(data, binary_dictionary(dictionary));
+  solutions._num_secrets = read_le<uint16_t>(data + 8);
+  const int num_solutions = read_le<uint16_t>(data + 10);
+  size_t pos = header_size;
+  for (int i = 0; i < num_solutions; i++) {
+    if (size - pos < 4) { return Error("Solution is truncated"); }
+    const size_t solution_size = read_le<uint32_t>(data + pos);
+    pos += 4;
+    if (solution_size > size - pos) { return Error("Solution is truncated"); }
+    bail_unit(validate_solution(data + pos, solution_size, dictionary.size()));
+    solutions._offsets.push_back(pos);
+    pos += solution_size;
+  }
+  if (pos != size) { return Error("Trailing bytes after the solutions"); }
+  return solutions;
+}
+
+int BinarySolutions::size() const { return _offsets.size(); }
+
+WordInfo BinarySolutions::word_info(int idx) const
+{
+  const uint8_t* p = _data + _offsets.at(idx);
+  WordInfo info;
+  info.first_guess = _dictionary->at(read_le<uint16_t>(p));
+  info.avg_guesses =
+    _num_secrets == 0 ? 0 : double(read_le<uint32_t>(p + 2)) / _num_secrets;
+  info.worst_num_guesses = p[6];
+  info.max_depth = p[7];
+  for (int i = 0; i < p[8]; i++) { info.all_matches.emplace_back(p[9 + i]); }
+  info.can_stop = true;
+  return info;
+}
+
+optional<BinaryTreeNode> BinarySolutions::tree(int idx) const
+{
+  const uint8_t* p = _data + _offsets.at(idx);
+  const uint8_t* tree_size = p + 9 + p[8];
+  if (read_le<uint32_t>(tree_size) == 0) return nullopt;
+  return BinaryTreeNode(tree_size + 4, _dictionary.get());
+}
+
+optional<pair<int, BinaryTreeNode>> BinarySolutions::follow_from(
+  const vector<pair<InternalString, Match>>& moves) const
+{
+  if (moves.empty()) return nullopt;
+
+  optional<BinaryTreeNode> node;
+  int idx = 0;
+  for (; idx < size(); idx++) {
+    node = tree(idx);
+    if (node.has_value() && node->guess() == moves[0].first) break;
+  }
+  for (const auto& move : moves) {
+    if (!node.has_value() || node->guess() != move.first) return nullopt;
+    node = node->child(move.second);
+  }
+  if (!node.has_value()) return nullopt;
+  return make_pair(idx, *node);
+}
+
+optional<BinaryTreeNode> BinarySolutions::follow(
+  const vector<pair<InternalString, Match>>& moves) const
+{
+  auto found = follow_from(moves);
+  if (!found.has_value()) return nullopt;
+  return found->second;
+}
+
+optional<WordInfo> BinarySolutions::next_move(
+  const vector<pair<InternalString, Match>>& moves) const
+{
+  auto found = follow_from(moves);
+  if (!found.has_value()) return nullopt;
+  const auto& node = found->second;
+
+  WordInfo info;
+  info.first_guess = node.guess();
+  info.avg_guesses = double(node.total_guesses()) / node.num_secrets();
+  info.worst_num_guesses = node.longest_path();
+  info.max_depth = read_le<uint8_t>(_data + _offsets.at(found->first) + 7);
+  info.all_matches = node.patterns();
+  info.can_stop = true;
+  return info;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "decision_tree.hpp"
+#include "internal_string.hpp"
+#include "match.hpp"
+#include "simulator.hpp"
+#include "utils/error.hpp"
+
+// Node of a tree in the binary encoding of DecisionTree, read in place from
+// a buffer that must outlive it.
+struct BinaryTreeNode {
+ public:
+  BinaryTreeNode(const uint8_t* data, const WordList* dictionary);
+
+  InternalString guess() const;
+  int num_secrets() const;
+  int longest_path() const;
+
+  std::vector<Match> patterns() const;
+
+  // The node for the secrets left after getting the pattern, skipping over
+  // the subtrees of the others. Nothing when the pattern can't happen or
+  // found the secret.
+  std::optional<BinaryTreeNode> child(Match match) const;
+
+  // Sum of the guesses needed for each secret, walks the whole subtree
+  int total_guesses() const;
+
+ private:
+  const uint8_t* _data;
+  const WordList* _dictionary;
+};
+
+// Solution file with the best first guesses of a game state, as written by
+// evaluate. The binary encoding is little endian, "BSL1" followed by the
+// dictionary size as a u32, the number of secrets as a u16 and the number of
+// solutions as a u16. Each solution starts with its size in bytes as a u32,
+// then the first guess as a u16 index into the dictionary, the total number of
+// guesses over all secrets as a u32, the worst case and the search depth as
+// u8s, the number of patterns the guess can get as a u8 and their codes as
+// u8s. It ends with the size of its decision tree as a u32, 0 when there's
+// none, and the tree node, see DecisionTree.
+//
+// Buffers are validated once when loaded and read in place afterwards.
+struct BinarySolutions {
+ public:
+  static OrError<std::string> encode(
+    const std::vector<WordInfo>& solutions,
+    const std::map<InternalString, const DecisionTree*>& trees,
+    const WordList& dictionary,
+    int num_secrets);
+
+  // The dictionary is the allowed guesses of the state the file was written
+  // for, in any order. The buffer must outlive the returned value.
+  static OrError<BinarySolutions> of_buffer(
+    const uint8_t* data, size_t size, const WordList& dictionary);
+
+  int size() const;
+
+  WordInfo word_info(int idx) const;
+
+  std::optional<BinaryTreeNode> tree(int idx) const;
+
+  // Follows the trees along the guesses played and patterns got since the
+  // state of the file, returns the node with the next guess to play. Nothing
+  // when a guess strays from the trees or no guess was played yet.
+  std::optional<BinaryTreeNode> follow(
+    const std::vector<std::pair<InternalString, Match>>& moves) const;
+
+  // The node found by follow as a solution of the state it was reached at
+  std::optional<WordInfo> next_move(
+    const std::vector<std::pair<InternalString, Match>>& moves) const;
+
+ private:
+  BinarySolutions(const uint8_t* data, WordList dictionary);
+
+  std::optional<std::pair<int, BinaryTreeNode>> follow_from(
+    const std::vector<std::pair<InternalString, Match>>& moves) const;
+
+  const uint8_t* _data;
+  std::vector<size_t> _offsets;
+  // Owned, so that nodes can point to it for as long as the buffer lives
+  std::shared_ptr<const WordList> _dictionary;
+  int _num_secrets = 0;
+};
@@ -74,7 +74,7 @@ const CacheEntry Cache::find(int depth, const CacheKey& key)
 {
   assert(depth < max_depth);
   size_t segment = key.lower_hash % _cache_segments;
-#ifdef _DESKTOP
+#ifdef _SHARED_CACHES
   lock_guard<mutex> lock(_mutex[segment]);
 #endif
   return _find(depth, key, segment);
@@ -91,7 +91,7 @@ void Cache::update(
 {
   assert(depth < max_depth);
   size_t segment = key.lower_hash % _cache_segments;
-#ifdef _DESKTOP
+#ifdef _SHARED_CACHES
   lock_guard<mutex> lock(_mutex[segment]);
 #endif
   _find(depth, key, segment).update(num_guesses, alpha, beta, word, optimal);
@@ -10,6 +10,12 @@
 
 #include "internal_string.hpp"
 
+// Builds where several threads search on the same caches, the single threaded
+// wasm build leaves the locks out
+#if defined(_DESKTOP) || defined(_WASM_THREADS)
+#define _SHARED_CACHES
+#endif
+
 struct CacheKey {
   uint64_t lower_hash = 0;
   uint64_t upper_hash = 0;
@@ -98,7 +104,7 @@ struct Cache {
     _cache_segments>
     _cache;
 
-#ifdef _DESKTOP
+#ifdef _SHARED_CACHES
   std::array<std::mutex, _cache_segments> _mutex;
 #endif
 };
@@ -0,0 +1,140 @@
+#include "candidate_width.hpp"
+
+#include "utils/format.hpp"
+#include "utils/format_vector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Adaptive widths only kick in after this many samples for a class
+constexpr int min_samples = 32;
+
+// Fraction of the best guesses that must fall within the covering rank
+constexpr double covered_fraction = 0.95;
+
+int builtin_width(bool hard_mode, size_t num_guesses)
+{
+  return hard_mode ? max(20, min<int>(80, 20 + (num_guesses + 1) / 2)) : 100;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// WidthPolicy
+//
+
+function<WidthPolicy()> WidthPolicy::param(CommandBuilder& builder)
+{
+  WidthPolicy def;
+  auto adaptive = builder.no_arg("--adaptive-width");
+  auto progressive = builder.no_arg("--progressive-width");
+  auto min_width =
+    builder.optional_with_default("--min-width", int_flag, def.min_width);
+  auto max_width =
+    builder.optional_with_default("--max-width", int_flag, def.max_width);
+  auto margin =
+    builder.optional_with_default("--width-margin", float_flag, def.margin);
+  auto progressive_initial_width = builder.optional_with_default(
+    "--progressive-initial-width", int_flag, def.progressive_initial_width);
+
+  return [=]() {
+    return WidthPolicy{
+      .adaptive = adaptive->value(),
+      .progressive = progressive->value(),
+      .min_width = max(1, min_width->value()),
+      .max_width = max(1, max_width->value()),
+      .margin = margin->value(),
+      .progressive_initial_width = max(1, progressive_initial_width->value()),
+    };
+  };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CandidateWidth
+//
+
+CandidateWidth::CandidateWidth(const WidthPolicy& policy) : _policy(policy) {}
+
+CandidateWidth::~CandidateWidth() {}
+
+size_t CandidateWidth::_class_of(size_t num_secrets)
+{
+  size_t c = 0;
+  while (num_secrets > 1 && c + 1 < _num_classes) {
+    num_secrets >>= 1;
+    c++;
+  }
+  return c;
+}
+
+int CandidateWidth::width(
+  bool hard_mode, size_t num_guesses, size_t num_secrets, int max_depth) const
+{
+  int width = builtin_width(hard_mode, num_guesses);
+
+  if (_policy.adaptive) {
+    const auto& stats = _stats[_class_of(num_secrets)];
+    if (stats.num_samples >= min_samples) {
+      width = clamp<int>(
+        ceil(_policy.margin * stats.covering_rank),
+        _policy.min_width,
+        _policy.max_width);
+    }
+  }
+
+  if (_policy.progressive) {
+    int shift = clamp(max_depth - 2, 0, 16);
+    width = min(
+      width, max(_policy.min_width, _policy.progressive_initial_width << shift));
+  }
+
+  return max(1, width);
+}
+
+void CandidateWidth::add_rank(size_t num_secrets, int rank)
+{
+  auto& stats = _stats[_class_of(num_secrets)];
+  if (stats.rank_counts.size() <= size_t(rank)) {
+    stats.rank_counts.resize(rank + 1, 0);
+  }
+  stats.rank_counts[rank]++;
+  stats.num_samples++;
+
+  int needed = ceil(covered_fraction * stats.num_samples);
+  int acc = 0;
+  for (size_t r = 0; r < stats.rank_counts.size(); r++) {
+    acc += stats.rank_counts[r];
+    if (acc >= needed) {
+      stats.covering_rank = r;
+      break;
+    }
+  }
+}
+
+void CandidateWidth::debug() const
+{
+  fmt::print_line(
+    "Candidate width: adaptive:$ progressive:$ min:$ max:$ margin:$",
+    _policy.adaptive,
+    _policy.progressive,
+    _policy.min_width,
+    _policy.max_width,
+    _policy.margin);
+  for (size_t c = 0; c < _num_classes; c++) {
+    const auto& stats = _stats[c];
+    if (stats.num_samples == 0) continue;
+    bool adapted = _policy.adaptive && stats.num_samples >= min_samples;
+    fmt::print_line(
+      "  secrets:$-$ samples:$ covering_rank:$ width:$",
+      size_t(1) << c,
+      (size_t(2) << c) - 1,
+      stats.num_samples,
+      stats.covering_rank,
+      adapted ? fmt::format("$", width(false, 0, size_t(1) << c, 18))
+              : string("builtin"));
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "utils/command.hpp"
+
+// How many of the best scoring candidates min_search tries at each node
+struct WidthPolicy {
+  // Derive the width from the ranks at which the best guess was found so far,
+  // instead of the fixed built-in widths.
+  bool adaptive = false;
+
+  // Try fewer candidates at nodes with little remaining depth, so early
+  // iterations of iterative deepening are cheap and later ones widen.
+  bool progressive = false;
+
+  int min_width = 4;
+  int max_width = 400;
+
+  // The width is this many times the rank that covered most of the best
+  // guesses seen so far.
+  double margin = 2.0;
+
+  // Width at nodes with 2 remaining depth when progressive, doubling for each
+  // extra depth.
+  int progressive_initial_width = 8;
+
+  static std::function<WidthPolicy()> param(CommandBuilder& builder);
+};
+
+struct CandidateWidth {
+ public:
+  CandidateWidth(const WidthPolicy& policy);
+  ~CandidateWidth();
+
+  int width(
+    bool hard_mode, size_t num_guesses, size_t num_secrets, int max_depth)
+    const;
+
+  void add_rank(size_t num_secrets, int rank);
+
+  void debug() const;
+
+ private:
+  // Stats are kept separately per power of two of the number of secrets
+  constexpr static size_t _num_classes = 16;
+
+  struct RankStats {
+    std::vector<int> rank_counts;
+    int num_samples = 0;
+    int covering_rank = 0;
+  };
+
+  static size_t _class_of(size_t num_secrets);
+
+  WidthPolicy _policy;
+  std::array<RankStats, _num_classes> _stats;
+};
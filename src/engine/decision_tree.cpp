@@ -0,0 +1,137 @@
+#include "decision_tree.hpp"
+
+#include "binary_format.hpp"
+#include "simulator.hpp"
+
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace {
+
+const string binary_magic = "BTR1";
+
+unique_ptr<DecisionTree> leaf(InternalString secret)
+{
+  auto node = make_unique<DecisionTree>();
+  node->guess = secret;
+  node->num_secrets = 1;
+  node->longest_path = 1;
+  node->children.emplace_back(Match(0), nullptr);
+  return node;
+}
+
+} // namespace
+
+DecisionTree::~DecisionTree() {}
+
+OrError<unique_ptr<DecisionTree>> DecisionTree::of_sim_node(const SimNode& node)
+{
+  if (node.output.empty()) {
+    return Error("Simulated node has no outputs, the tree wasn't kept");
+  }
+
+  auto tree = make_unique<DecisionTree>();
+  tree->guess = node.guess;
+  tree->num_secrets = node.output.size();
+  tree->longest_path = 0;
+
+  array<vector<InternalString>, 256> buckets;
+  for (const auto& info : node.output) {
+    tree->longest_path = max(tree->longest_path, info.num_guesses);
+    buckets[Match::match(node.guess, info.secret).code()].push_back(
+      info.secret);
+  }
+
+  array<const SimNode*, 256> sim_children;
+  sim_children.fill(nullptr);
+  for (const auto& child : node.children) {
+    sim_children[child.first.code()] = child.second.get();
+  }
+
+  for (int code = 0; code < 256; code++) {
+    const auto& secrets = buckets[code];
+    if (secrets.empty()) continue;
+    Match match(code);
+    if (match.is_all_hit()) {
+      tree->children.emplace_back(match, nullptr);
+    } else if (sim_children[code] != nullptr) {
+      bail(child, of_sim_node(*sim_children[code]));
+      tree->children.emplace_back(match, move(child));
+    } else if (secrets.size() == 1) {
+      tree->children.emplace_back(match, leaf(secrets[0]));
+    } else {
+      return Error::format(
+        "Simulated node $ is missing the child for $", node.guess, match);
+    }
+  }
+
+  sort(
+    tree->children.begin(),
+    tree->children.end(),
+    [](const auto& c1, const auto& c2) {
+      return c1.first.str() < c2.first.str();
+    });
+
+  return tree;
+}
+
+OrError<Unit> DecisionTree::append_binary(
+  const vector<int>& word_indices, string& output) const
+{
+  const int index = word_indices.at(guess.id());
+  if (index < 0) {
+    return Error::format("Word $ is not in the dictionary", guess);
+  }
+  if (num_secrets > 0xffff || longest_path > 0xff) {
+    return Error("Tree is too big for the binary format");
+  }
+  write_le<uint16_t>(output, index);
+  write_le<uint16_t>(output, num_secrets);
+  write_le<uint8_t>(output, longest_path);
+  write_le<uint8_t>(output, children.size());
+  for (const auto& child : children) {
+    write_le<uint8_t>(output, child.first.code());
+    size_t size_pos = output.size();
+    write_le<uint32_t>(output, 0);
+    if (child.second == nullptr) continue;
+    size_t start = output.size();
+    bail_unit(child.second->append_binary(word_indices, output));
+    patch_u32_le(output, size_pos, output.size() - start);
+  }
+  return unit;
+}
+
+OrError<string> DecisionTree::to_binary(const WordList& dictionary) const
+{
+  bail(indices, binary_word_indices(dictionary));
+  string output = binary_magic;
+  write_le<uint32_t>(output, dictionary.size());
+  bail_unit(append_binary(indices, output));
+  return output;
+}
+
+namespace json {
+
+JsonValue to_json_t<DecisionTree>::convert(const DecisionTree& value)
+{
+  vector<JsonValue> patterns;
+  for (const auto& child : value.children) {
+    map<string, JsonValue> pattern{
+      {"p", to_json(child.first)},
+      {"n",
+       child.second == nullptr ? JsonValue(null) : to_json(*child.second)},
+    };
+    patterns.push_back(to_json(pattern));
+  }
+  map<string, JsonValue> obj{
+    {"w", to_json(value.guess)},
+    {"s", to_json(value.num_secrets)},
+    {"l", to_json(value.longest_path)},
+    {"p", to_json(patterns)},
+  };
+  return to_json(obj);
+}
+
+} // namespace json
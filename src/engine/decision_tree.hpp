@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "internal_string.hpp"
+#include "match.hpp"
+#include "utils/error.hpp"
+#include "utils/json.hpp"
+
+struct SimNode;
+
+// A strategy as a full decision tree, the guess to make at a node and the node
+// to go to for each pattern it can get.
+//
+// In JSON a node is {"w": guess, "s": num_secrets, "l": longest_path,
+// "p": [{"p": pattern, "n": node or null}]}, with the patterns sorted and a
+// null node once the secret was found.
+//
+// The binary encoding is little endian, "BTR1" followed by the dictionary size
+// as a u32 and the root node. A node is the guess as a u16 index into the
+// dictionary, num_secrets as a u16, longest_path as a u8 and the number of
+// patterns as a u8. Each pattern follows as its code in a u8, the size in bytes
+// of its node as a u32, 0 when there is none, and the node itself, so readers
+// can skip the subtrees they don't need. The dictionary is the allowed guesses
+// sorted alphabetically.
+struct DecisionTree {
+  InternalString guess;
+  int num_secrets;
+  // Number of guesses needed in the worst case, counting this node's guess
+  int longest_path;
+  std::vector<std::pair<Match, std::unique_ptr<DecisionTree>>> children;
+
+  ~DecisionTree();
+
+  // The node needs its outputs and children, see Simulator::set_keep_tree
+  static OrError<std::unique_ptr<DecisionTree>> of_sim_node(
+    const SimNode& node);
+
+  OrError<std::string> to_binary(const WordList& dictionary) const;
+
+  // Appends the node alone, without the header, see binary_word_indices
+  OrError<Unit> append_binary(
+    const std::vector<int>& word_indices, std::string& output) const;
+};
+
+namespace json {
+
+template <> struct to_json_t<DecisionTree> {
+  static JsonValue convert(const DecisionTree& value);
+};
+
+} // namespace json
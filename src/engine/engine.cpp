@@ -8,16 +8,21 @@
 #include "cache.hpp"
 #include "greedy.hpp"
 #include "match.hpp"
+#include "opening_book.hpp"
 #include "utils/format_map.hpp"
 #include "utils/format_optional.hpp"
 #include "utils/format_set.hpp"
 #include "utils/format_vector.hpp"
+#include "utils/small_hash.hpp"
 
 using namespace std;
 using namespace fmt;
 
 namespace {
 
+// Nodes with at most this many possible secrets get their guesses reduced
+constexpr size_t reduce_guesses_max_secrets = 32;
+
 struct Bucket {
   vector<InternalString> allowed_guesses;
   vector<InternalString> possible_secrets;
@@ -26,10 +31,25 @@ struct Bucket {
 
 } // namespace
 
-Engine::Engine(CachePair& cache_pair, bool verbose)
-    : _cache_pair(cache_pair), _verbose(verbose)
+Engine::Engine(
+  CachePair& cache_pair, bool verbose, const WidthPolicy& width_policy)
+    : _cache_pair(cache_pair),
+      _verbose(verbose),
+      _width_policy(width_policy),
+      _guess_reducer(reduce_guesses_max_secrets),
+      _candidate_width(width_policy)
 {}
 
+Engine::~Engine() {}
+
+unique_ptr<SearchEngine> Engine::fork() const
+{
+  auto engine = make_unique<Engine>(_cache_pair, _verbose, _width_policy);
+  engine->set_budget(_budget);
+  engine->set_opening_book(_opening_book);
+  return engine;
+}
+
 Engine::MaxSearchResult Engine::max_search(
   const vector<InternalString>& allowed_guesses,
   const vector<InternalString>& possible_secrets,
@@ -53,6 +73,8 @@ Engine::MaxSearchResult Engine::max_search(
     }
   }
 
+  if (_budget.poll()) { return MaxSearchResult(beta, false); }
+
   auto do_it = [&]() -> MaxSearchResult {
     array<Bucket, 256> buckets;
     for (int i = 0; i < 256; i++) { buckets[i].match = Match(i); }
@@ -96,6 +118,7 @@ Engine::MaxSearchResult Engine::max_search(
         best_num_guesses,
         beta,
         false);
+      if (_budget.is_exhausted()) { return MaxSearchResult(beta, false); }
       if (res.num_guesses > best_num_guesses) {
         best_num_guesses = res.num_guesses;
         is_optimal = res.is_optimal;
@@ -109,14 +132,16 @@ Engine::MaxSearchResult Engine::max_search(
   };
 
   auto ret = do_it();
-  _cache_pair.max_cache.update(
-    max_depth,
-    cache_key,
-    ret.num_guesses,
-    alpha,
-    beta,
-    InternalString(),
-    ret.is_optimal);
+  if (!_budget.is_exhausted()) {
+    _cache_pair.max_cache.update(
+      max_depth,
+      cache_key,
+      ret.num_guesses,
+      alpha,
+      beta,
+      InternalString(),
+      ret.is_optimal);
+  }
 
   return ret;
 }
@@ -206,6 +231,14 @@ SearchResult Engine::min_search(
     };
   }
 
+  if (_budget.poll()) {
+    return SearchResult{
+      .best_guess = possible_secrets[0],
+      .num_guesses = int(possible_secrets.size()),
+      .is_optimal = false,
+    };
+  }
+
   auto result = [&]() {
     auto shallow_cache_entry =
       _cache_pair.min_cache.find(max_depth - 1, cache_key);
@@ -220,22 +253,28 @@ SearchResult Engine::min_search(
       };
     }
 
+    GuessReducer::WordListPtr reduced_guesses;
+    if (!_hard_mode) {
+      reduced_guesses = _guess_reducer.reduce(
+        cache_key ^ _allowed_guesses_key, allowed_guesses, possible_secrets);
+    }
+    const auto& guesses =
+      reduced_guesses != nullptr ? *reduced_guesses : allowed_guesses;
+
     if (max_depth <= 1) {
-      return pick_greedy_guess(allowed_guesses, possible_secrets, beta);
+      return pick_greedy_guess(guesses, possible_secrets, beta);
     }
 
     vector<pair<int, InternalString>> sorted_candidates;
     {
-      const int how_many_to_try =
-        _hard_mode
-          ? max(20, min<int>(80, 20 + (allowed_guesses.size() + 1) / 2))
-          : 100;
+      const int how_many_to_try = _candidate_width.width(
+        _hard_mode, guesses.size(), possible_secrets.size(), max_depth);
       sorted_candidates.reserve(how_many_to_try + 1);
 
       int min_score = 10000000;
 
       int beta_remaining = possible_secrets.size();
-      for (const auto& guess_candidate : allowed_guesses) {
+      for (const auto& guess_candidate : guesses) {
         auto s = worst_remaining_possible_after_one_guess(
                    guess_candidate, possible_secrets, beta_remaining)
                    .first;
@@ -268,12 +307,18 @@ SearchResult Engine::min_search(
         guess_candidate.is_valid() &&
         "Got invalid candidate, how did this even happen?");
       auto res = max_search(
-        allowed_guesses,
+        guesses,
         possible_secrets,
         guess_candidate,
         max_depth,
         max(1, alpha - 1),
         max(1, best_num_guesses - 1));
+      if (_budget.is_exhausted()) {
+        // Out of budget, the value of this candidate is unknown
+        if (best_guess.is_empty()) { best_guess = guess_candidate; }
+        is_optimal = false;
+        break;
+      }
       assert(res.num_guesses > 0);
       int num_guesses = res.num_guesses + 1;
       if (num_guesses < best_num_guesses || best_guess.is_empty()) {
@@ -298,7 +343,10 @@ SearchResult Engine::min_search(
 
     assert(!best_guess.is_empty());
 
-    if (best_rank >= 0) { add_rank(best_rank); }
+    if (best_rank >= 0 && !_budget.is_exhausted()) {
+      add_rank(best_rank);
+      _candidate_width.add_rank(possible_secrets.size(), best_rank);
+    }
     assert(best_num_guesses > 0);
     return SearchResult{
       .best_guess = best_guess,
@@ -309,22 +357,29 @@ SearchResult Engine::min_search(
 
   assert(result.num_guesses > 0);
 
-  _cache_pair.min_cache.update(
-    max_depth,
-    cache_key,
-    result.num_guesses,
-    alpha,
-    beta,
-    result.best_guess,
-    result.is_optimal);
+  if (!_budget.is_exhausted()) {
+    _cache_pair.min_cache.update(
+      max_depth,
+      cache_key,
+      result.num_guesses,
+      alpha,
+      beta,
+      result.best_guess,
+      result.is_optimal);
+  }
 
   return result;
 }
 
-OrError<SearchResult> Engine::search(const GameState& game_state, int max_depth)
+OrError<SearchResult> Engine::search(
+  const GameStateView& game_state, int max_depth)
 {
   assert(max_depth > 0);
-  _hard_mode = game_state.is_hard_mode();
+  if (_opening_book != nullptr) {
+    const auto* entry = _opening_book->find(game_state);
+    if (entry != nullptr && entry->search.is_optimal) { return entry->search; }
+  }
+  start_search(game_state);
   auto result = min_search(
     game_state.allowed_guesses(),
     game_state.possible_secrets(),
@@ -332,6 +387,8 @@ OrError<SearchResult> Engine::search(const GameState& game_state, int max_depth)
     0,
     game_state.possible_secrets().size(),
     true);
+  // A search cut off at the root has no answer, only a placeholder
+  if (_budget.is_exhausted()) { return Error("Search budget exhausted"); }
   if (result.best_guess.is_empty()) {
     return Error::format(
       "Engine failed to find a word $ $",
@@ -341,6 +398,82 @@ OrError<SearchResult> Engine::search(const GameState& game_state, int max_depth)
   return result;
 }
 
+OrError<vector<MultiPvEntry>> Engine::search_multipv(
+  const GameStateView& game_state, int max_depth, int n)
+{
+  assert(max_depth > 0);
+  assert(n > 0);
+  start_search(game_state);
+
+  const auto& allowed_guesses = game_state.allowed_guesses();
+  const auto& possible_secrets = game_state.possible_secrets();
+  const int num_secrets = possible_secrets.size();
+
+  vector<pair<int, InternalString>> sorted_candidates;
+  sorted_candidates.reserve(allowed_guesses.size());
+  for (const auto& guess_candidate : allowed_guesses) {
+    auto s = worst_remaining_possible_after_one_guess(
+               guess_candidate, possible_secrets, num_secrets)
+               .first;
+    sorted_candidates.emplace_back(s, guess_candidate);
+  }
+  stable_sort(
+    sorted_candidates.begin(),
+    sorted_candidates.end(),
+    [](const auto& c1, const auto& c2) { return c1.first < c2.first; });
+
+  vector<MultiPvEntry> entries;
+  for (const auto& guess_candidate_pair : sorted_candidates) {
+    const InternalString guess_candidate = guess_candidate_pair.second;
+
+    // Only values strictly better than the n-th best matter, anything else
+    // gets cut off as soon as it is known not to make it.
+    int bound = int(entries.size()) < n ? num_secrets + 1
+                                        : entries.back().num_guesses;
+    int beta = max(1, bound - 1);
+    auto res = max_search(
+      allowed_guesses, possible_secrets, guess_candidate, max_depth, 1, beta);
+    if (_budget.is_exhausted()) { break; }
+
+    MultiPvEntry entry{
+      .guess = guess_candidate,
+      .num_guesses = res.num_guesses + 1,
+      .is_exact = res.num_guesses < beta,
+      .is_optimal = res.is_optimal,
+    };
+    if (int(entries.size()) >= n && !entry.is_exact) { continue; }
+
+    auto it = upper_bound(
+      entries.begin(), entries.end(), entry, [](const auto& e1, const auto& e2) {
+        if (e1.is_exact != e2.is_exact) { return e1.is_exact; }
+        return e1.num_guesses < e2.num_guesses;
+      });
+    entries.insert(it, entry);
+    if (int(entries.size()) > n) { entries.pop_back(); }
+  }
+
+  if (entries.empty()) {
+    return Error("Engine failed to rank any guess");
+  }
+  return entries;
+}
+
+void Engine::start_search(const GameStateView& game_state)
+{
+  _budget.check();
+  _hard_mode = game_state.is_hard_mode();
+  if (!_hard_mode) {
+    // The reduced guesses depend on what was allowed at the root, mix it in
+    // non-linearly so it doesn't cancel out with the secrets key.
+    auto key =
+      _cache_pair.min_cache.min_search_key(game_state.allowed_guesses());
+    _allowed_guesses_key = CacheKey{
+      .lower_hash = hash64(key.lower_hash),
+      .upper_hash = hash64(key.upper_hash),
+    };
+  }
+}
+
 void Engine::add_rank(int rank)
 {
   if (rank_distribution.size() <= size_t(rank)) {
@@ -352,6 +485,11 @@ void Engine::add_rank(int rank)
 void Engine::set_verbose(bool verbose) { _verbose = verbose; }
 bool Engine::get_verbose() const { return _verbose; }
 
+void Engine::set_opening_book(const OpeningBook* opening_book)
+{
+  _opening_book = opening_book;
+}
+
 void Engine::debug()
 {
   map<int, int> v;
@@ -370,6 +508,8 @@ void Engine::debug()
   }
   fmt::print_line("Distribution of best word rank: $", v);
   fmt::print_line("Distribution of best word rank: $", d);
+  _guess_reducer.debug();
+  _candidate_width.debug();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
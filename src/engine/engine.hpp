@@ -4,10 +4,14 @@
 #include <set>
 
 #include "cache.hpp"
+#include "candidate_width.hpp"
 #include "game_state.hpp"
 #include "greedy.hpp"
+#include "guess_reducer.hpp"
+#include "search_engine.hpp"
 
 struct MultiSearchContext;
+struct OpeningBook;
 
 struct CachePair {
   Cache min_cache;
@@ -16,16 +20,47 @@ struct CachePair {
   ~CachePair();
 };
 
-struct Engine {
+struct MultiPvEntry {
+  InternalString guess;
+  int num_guesses;
+  // When false num_guesses is only a lower bound, the guess was cut off
+  // because it could not make it into the list.
+  bool is_exact;
+  bool is_optimal;
+};
+
+struct Engine : public SearchEngine {
  public:
-  Engine(CachePair& cache, bool verbose);
+  Engine(
+    CachePair& cache,
+    bool verbose,
+    const WidthPolicy& width_policy = WidthPolicy());
+
+  virtual ~Engine();
 
-  OrError<SearchResult> search(const GameState& game_state, int max_depth);
+  // Fails with "Search budget exhausted" when the budget runs out before the
+  // search is done. The cut off search only has a placeholder guess, callers
+  // deepening iteratively keep the result of the last depth that finished.
+  virtual OrError<SearchResult> search(
+    const GameStateView& game_state, int max_depth);
+
+  virtual std::unique_ptr<SearchEngine> fork() const;
+
+  // Returns the n best guesses for the game state, best first. All root
+  // guesses are searched with a bound on the n-th best value found so far,
+  // so it costs much less than n separate searches. When the budget runs out
+  // only the guesses ranked by then are returned.
+  OrError<std::vector<MultiPvEntry>> search_multipv(
+    const GameStateView& game_state, int max_depth, int n);
 
   void debug();
 
   void set_verbose(bool verbose);
 
+  // Searches of states in the book return its move right away when it was
+  // proven optimal. The book must outlive the engine and its forks.
+  void set_opening_book(const OpeningBook* opening_book);
+
   bool get_verbose() const;
 
  private:
@@ -34,6 +69,15 @@ struct Engine {
   bool _verbose;
   bool _hard_mode;
 
+  WidthPolicy _width_policy;
+
+  const OpeningBook* _opening_book = nullptr;
+
+  GuessReducer _guess_reducer;
+  CacheKey _allowed_guesses_key;
+
+  CandidateWidth _candidate_width;
+
   std::vector<int> rank_distribution;
 
   struct MaxSearchResult {
@@ -62,4 +106,6 @@ struct Engine {
     bool is_root);
 
   void add_rank(int rank);
+
+  void start_search(const GameStateView& game_state);
 };
@@ -184,17 +184,53 @@ bool GameState::is_hard_mode() const { return _hard_mode; }
 
 array<Partition, 256> GameState::partition_by_pattern(
   InternalString guess) const
+{
+  return GameStateView(*this).partition_by_pattern(guess);
+}
+
+GameState GameState::state_from_partition(const Partition& partition) const
+{
+  auto state = GameState(
+    _hard_mode ? partition._allowed_guesses : _allowed_guesses,
+    partition._possible_secrets,
+    _hard_mode);
+  state.drop_useless_guesses();
+  return state;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// GameStateView
+//
+
+GameStateView::GameStateView(const GameState& game_state)
+    : GameStateView(
+        &game_state.allowed_guesses(),
+        &game_state.possible_secrets(),
+        game_state.is_hard_mode())
+{}
+
+GameStateView::GameStateView(
+  const WordList* allowed_guesses,
+  const WordList* possible_secrets,
+  bool hard_mode)
+    : _allowed_guesses(allowed_guesses),
+      _possible_secrets(possible_secrets),
+      _hard_mode(hard_mode)
+{}
+
+array<Partition, 256> GameStateView::partition_by_pattern(
+  InternalString guess) const
 {
   array<Partition, 256> buckets;
   for (int i = 0; i < 256; i++) { buckets[i]._match = Match(i); }
-  for (InternalString possible_secret : _possible_secrets) {
+  for (InternalString possible_secret : *_possible_secrets) {
     auto r = Match::match(guess, possible_secret);
     auto& b = buckets.at(r.code());
     b._possible_secrets.push_back(possible_secret);
   }
 
   if (_hard_mode) {
-    for (InternalString allowed_guess : _allowed_guesses) {
+    for (InternalString allowed_guess : *_allowed_guesses) {
       auto r = Match::match(guess, allowed_guess);
       buckets[r.code()]._allowed_guesses.push_back(allowed_guess);
     }
@@ -202,12 +238,12 @@ array<Partition, 256> GameState::partition_by_pattern(
   return buckets;
 }
 
-GameState GameState::state_from_partition(const Partition& partition) const
+GameStateView GameStateView::view_from_partition(
+  const Partition& partition) const
 {
-  auto state = GameState(
-    _hard_mode ? partition._allowed_guesses : _allowed_guesses,
-    partition._possible_secrets,
+  // Useless guesses are left in, the engine drops the ones that matter
+  return GameStateView(
+    _hard_mode ? &partition._allowed_guesses : _allowed_guesses,
+    &partition._possible_secrets,
     _hard_mode);
-  state.drop_useless_guesses();
-  return state;
 }
@@ -11,6 +11,7 @@ struct Partition {
  public:
   bool is_empty() const { return _possible_secrets.empty(); }
   Match match() const { return _match; }
+  size_t size() const { return _possible_secrets.size(); }
 
  private:
   WordList _allowed_guesses;
@@ -18,6 +19,36 @@ struct Partition {
   Match _match = Match(0);
 
   friend struct GameState;
+  friend struct GameStateView;
+};
+
+struct GameState;
+
+// A game state that doesn't own any word lists, it points into the GameState
+// or Partition it was made from, which must outlive it. In easy mode every
+// view shares the allowed guesses of the root state. Used by the simulator to
+// walk the game tree without copying the allowed guesses at every node.
+struct GameStateView {
+ public:
+  GameStateView(const GameState& game_state);
+
+  const WordList& allowed_guesses() const { return *_allowed_guesses; }
+  const WordList& possible_secrets() const { return *_possible_secrets; }
+  bool is_hard_mode() const { return _hard_mode; }
+
+  std::array<Partition, 256> partition_by_pattern(InternalString guess) const;
+
+  GameStateView view_from_partition(const Partition& partition) const;
+
+ private:
+  GameStateView(
+    const WordList* allowed_guesses,
+    const WordList* possible_secrets,
+    bool hard_mode);
+
+  const WordList* _allowed_guesses;
+  const WordList* _possible_secrets;
+  bool _hard_mode;
 };
 
 struct GameState {
@@ -97,3 +97,16 @@ SearchResult pick_greedy_guess(
     .is_optimal = num_guesses <= 2,
   };
 }
+
+int64_t predicted_simulation_cost(
+  const InternalString guess, const vector<InternalString>& possible_secrets)
+{
+  array<int64_t, 256> buckets;
+  buckets.fill(0);
+  for (const auto& possible_secret : possible_secrets) {
+    buckets[Match::match(guess, possible_secret).code()]++;
+  }
+  int64_t cost = 0;
+  for (const auto size : buckets) { cost += size * size; }
+  return cost;
+}
@@ -26,3 +26,10 @@ SearchResult pick_greedy_guess(
 uint32_t hash_remaining_secrets(
   const InternalString guess_candidate,
   const std::vector<InternalString>& possible_secrets);
+
+// Rough estimate of the work to simulate a first guess, the sum of the squared
+// bucket sizes of its partition. A big bucket needs deep searches over many
+// candidates, while a guess with only small buckets is proven quickly.
+int64_t predicted_simulation_cost(
+  const InternalString guess,
+  const std::vector<InternalString>& possible_secrets);
@@ -0,0 +1,163 @@
+#include "guess_reducer.hpp"
+
+#include "match.hpp"
+#include "utils/format.hpp"
+#include "utils/small_hash.hpp"
+
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t max_cache_entries = 1 << 16;
+
+// Comparing against every kept partition is quadratic, the ones with the most
+// buckets are the likely dominators anyway.
+constexpr size_t max_dominators_to_check = 16;
+
+struct Split {
+  size_t guess_idx;
+  size_t labels_offset;
+  int num_buckets;
+  bool is_hit;
+};
+
+// Returns whether every bucket of `fine` is contained in a bucket of `coarse`
+bool refines(const uint8_t* fine, const uint8_t* coarse, size_t size)
+{
+  array<uint8_t, 256> bucket_map;
+  bucket_map.fill(0xff);
+  for (size_t i = 0; i < size; i++) {
+    auto& m = bucket_map[fine[i]];
+    if (m == 0xff) {
+      m = coarse[i];
+    } else if (m != coarse[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+GuessReducer::GuessReducer(size_t max_secrets) : _max_secrets(max_secrets) {}
+
+GuessReducer::~GuessReducer() {}
+
+GuessReducer::WordListPtr GuessReducer::reduce(
+  const CacheKey& key,
+  const WordList& allowed_guesses,
+  const WordList& possible_secrets)
+{
+  const size_t num_secrets = possible_secrets.size();
+  if (num_secrets > _max_secrets || num_secrets <= 2) { return nullptr; }
+
+  {
+    auto it = _cache.find(key);
+    if (it != _cache.end()) {
+      _num_cache_hits++;
+      return it->second;
+    }
+  }
+
+  // Buckets are labeled in the order they first show up, so two guesses
+  // inducing the same partition get the same labels.
+  vector<uint8_t> labels;
+  vector<Split> splits;
+  unordered_map<uint64_t, size_t> split_by_hash;
+  vector<uint8_t> current(num_secrets);
+  for (size_t guess_idx = 0; guess_idx < allowed_guesses.size(); guess_idx++) {
+    const InternalString guess = allowed_guesses[guess_idx];
+    array<uint8_t, 256> relabel;
+    relabel.fill(0xff);
+    uint8_t num_buckets = 0;
+    bool is_hit = false;
+    uint64_t hash = 0;
+    for (size_t i = 0; i < num_secrets; i++) {
+      auto m = Match::match(guess, possible_secrets[i]);
+      if (m.is_all_hit()) { is_hit = true; }
+      auto& label = relabel[m.code()];
+      if (label == 0xff) { label = num_buckets++; }
+      current[i] = label;
+      hash = hash64(hash ^ label) + i;
+    }
+
+    // Doesn't split the secrets at all
+    if (num_buckets == 1) { continue; }
+
+    auto it = split_by_hash.find(hash);
+    if (it != split_by_hash.end()) {
+      auto& split = splits[it->second];
+      if (equal(
+            current.begin(), current.end(), &labels[split.labels_offset])) {
+        // Same partition, prefer the guess that might be the secret
+        if (is_hit && !split.is_hit) {
+          split.guess_idx = guess_idx;
+          split.is_hit = true;
+        }
+        continue;
+      }
+    }
+
+    split_by_hash.emplace(hash, splits.size());
+    splits.push_back(Split{
+      .guess_idx = guess_idx,
+      .labels_offset = labels.size(),
+      .num_buckets = num_buckets,
+      .is_hit = is_hit,
+    });
+    labels.insert(labels.end(), current.begin(), current.end());
+  }
+
+  if (splits.empty()) { return nullptr; }
+
+  stable_sort(splits.begin(), splits.end(), [](const auto& s1, const auto& s2) {
+    return s1.num_buckets > s2.num_buckets;
+  });
+
+  vector<bool> keep(allowed_guesses.size(), false);
+  vector<const Split*> kept;
+  for (const auto& split : splits) {
+    bool dominated = false;
+    for (size_t i = 0; i < min(kept.size(), max_dominators_to_check); i++) {
+      const auto* other = kept[i];
+      if (other->num_buckets <= split.num_buckets) { break; }
+      if (refines(
+            &labels[other->labels_offset],
+            &labels[split.labels_offset],
+            num_secrets)) {
+        dominated = true;
+        break;
+      }
+    }
+    if (dominated) { continue; }
+    kept.push_back(&split);
+    keep[split.guess_idx] = true;
+  }
+
+  auto reduced = make_shared<WordList>();
+  reduced->reserve(kept.size());
+  for (size_t i = 0; i < allowed_guesses.size(); i++) {
+    if (keep[i]) { reduced->push_back(allowed_guesses[i]); }
+  }
+
+  _num_reduced++;
+  _num_guesses_in += allowed_guesses.size();
+  _num_guesses_out += reduced->size();
+
+  if (_cache.size() >= max_cache_entries) { _cache.clear(); }
+  _cache.emplace(key, reduced);
+  return reduced;
+}
+
+void GuessReducer::debug() const
+{
+  fmt::print_line(
+    "Guess reducer: reduced:$ cache_hits:$ avg guesses before:$ after:$",
+    _num_reduced,
+    _num_cache_hits,
+    _num_reduced == 0 ? 0.0 : double(_num_guesses_in) / _num_reduced,
+    _num_reduced == 0 ? 0.0 : double(_num_guesses_out) / _num_reduced);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "cache.hpp"
+#include "internal_string.hpp"
+
+// Shrinks the list of guesses worth trying for a small set of possible
+// secrets. Guesses that split the secrets into the same buckets are collapsed
+// into one, and a guess is dropped if another guess splits each of its buckets
+// further. Both properties still hold for any subset of the secrets, so the
+// reduced list can be used for the whole subtree. It ignores which guesses are
+// allowed after each pattern, so it is only valid in easy mode.
+struct GuessReducer {
+ public:
+  using WordListPtr = std::shared_ptr<const WordList>;
+
+  GuessReducer(size_t max_secrets);
+  ~GuessReducer();
+
+  // Returns nullptr when there are too many secrets or nothing to drop, in
+  // which case the caller should keep using the given guesses.
+  WordListPtr reduce(
+    const CacheKey& key,
+    const WordList& allowed_guesses,
+    const WordList& possible_secrets);
+
+  void debug() const;
+
+ private:
+  size_t _max_secrets;
+
+  std::unordered_map<CacheKey, WordListPtr, CacheKey::Hasher> _cache;
+
+  size_t _num_reduced = 0;
+  size_t _num_cache_hits = 0;
+  size_t _num_guesses_in = 0;
+  size_t _num_guesses_out = 0;
+};
@@ -1,6 +1,9 @@
 #include "match.hpp"
 
 #include <array>
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
 
 #include "internal_string.hpp"
 #include "utils/format.hpp"
@@ -129,6 +132,97 @@ Match compute_match(
   return Match(encode(output));
 }
 
+#ifdef __wasm_simd128__
+
+// Only the table is built with SIMD. The searches look their secrets up in it
+// by id and count them into 256 buckets, wasm SIMD has neither the gather nor
+// the scatter that would take, so their loops stay scalar.
+
+// Lanes of the SIMD kernel, one secret per byte
+constexpr size_t simd_lanes = 16;
+
+// The letters of every word laid out by position, so that a vector load gets
+// the same letter of 16 consecutive words. Padded to a whole vector past the
+// last word, words that don't have 5 letters are left as 0.
+array<vector<uint8_t>, 5> letters_by_position(size_t max_id)
+{
+  array<vector<uint8_t>, 5> letters;
+  for (auto& l : letters) { l.assign(max_id + simd_lanes, 0); }
+  for (size_t id = 0; id < max_id; id++) {
+    const string& word = InternalString::from_id(id).str();
+    if (word.size() != 5) continue;
+    for (int p = 0; p < 5; p++) { letters[p][id] = word[p]; }
+  }
+  return letters;
+}
+
+// The codes of compute_match for a guess against 16 secrets at once. Same
+// rules: the hits first, then each letter of the guess takes the first letter
+// of the secret that isn't a hit and wasn't taken yet. Masks are 0 or -1 per
+// byte, the result of a letter is 2 + wrong_place + 2 * hit.
+v128_t compute_matches_simd(
+  const string& guess, const array<v128_t, 5>& secret_letters)
+{
+  array<v128_t, 5> guess_letters;
+  array<v128_t, 5> hits;
+  array<v128_t, 5> used;
+  for (int p = 0; p < 5; p++) {
+    guess_letters[p] = wasm_i8x16_splat(guess[p]);
+    hits[p] = wasm_i8x16_eq(secret_letters[p], guess_letters[p]);
+    used[p] = hits[p];
+  }
+  const v128_t two = wasm_i8x16_splat(2);
+  v128_t code = wasm_i8x16_splat(0);
+  for (int i = 0; i < 5; i++) {
+    v128_t found = hits[i];
+    for (int j = 0; j < 5; j++) {
+      const v128_t take = wasm_v128_andnot(
+        wasm_i8x16_eq(secret_letters[j], guess_letters[i]),
+        wasm_v128_or(used[j], found));
+      used[j] = wasm_v128_or(used[j], take);
+      found = wasm_v128_or(found, take);
+    }
+    const v128_t result =
+      wasm_i8x16_add(wasm_i8x16_add(two, found), hits[i]);
+    const v128_t code_times_3 =
+      wasm_i8x16_add(wasm_i8x16_add(code, code), code);
+    code = wasm_i8x16_add(code_times_3, result);
+  }
+  return code;
+}
+
+// Appends the matches of a guess against the secrets from the end of its row
+// up to max_id
+void fill_row_simd(
+  InternalString guess,
+  vector<Match>& row,
+  size_t max_id,
+  const array<vector<uint8_t>, 5>& letters)
+{
+  const string& guess_str = guess.str();
+  if (guess_str.size() != 5) {
+    while (row.size() < max_id) { row.push_back(Match(0)); }
+    return;
+  }
+  alignas(16) uint8_t codes[simd_lanes];
+  while (row.size() < max_id) {
+    const size_t first = row.size();
+    array<v128_t, 5> secret_letters;
+    for (int p = 0; p < 5; p++) {
+      secret_letters[p] = wasm_v128_load(letters[p].data() + first);
+    }
+    wasm_v128_store(codes, compute_matches_simd(guess_str, secret_letters));
+    const size_t count = min(simd_lanes, max_id - first);
+    for (size_t k = 0; k < count; k++) {
+      // Secrets without 5 letters were loaded as 0 and can't be trusted
+      const bool valid = letters[0][first + k] != 0;
+      row.push_back(Match(valid ? codes[k] : 0));
+    }
+  }
+}
+
+#endif
+
 } // namespace
 
 Match::Match(uint8_t id) : _id(id) {}
@@ -160,17 +254,24 @@ void Match::init_result_cache()
 {
   size_t max_id = InternalString::max_id();
 
-  _cache.clear();
+  // Ids are never reused without clearing the cache, only the words added
+  // since the last call need computing.
+#ifdef __wasm_simd128__
+  const auto letters = letters_by_position(max_id);
+#endif
   _cache.reserve(max_id);
-
   for (size_t i = 0; i < max_id; i++) {
-    vector<Match> row;
+    if (i == _cache.size()) { _cache.emplace_back(); }
+    auto& row = _cache[i];
     row.reserve(max_id);
-    for (size_t j = 0; j < max_id; j++) {
+#ifdef __wasm_simd128__
+    fill_row_simd(InternalString::from_id(i), row, max_id, letters);
+#else
+    for (size_t j = row.size(); j < max_id; j++) {
       row.push_back(
         compute_match(InternalString::from_id(i), InternalString::from_id(j)));
     }
-    _cache.emplace_back(move(row));
+#endif
   }
 }
 
@@ -0,0 +1,135 @@
+#include "opening_book.hpp"
+
+#include "hash_game_state.hpp"
+
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+using json::JsonValue;
+
+template <class T>
+OrError<const T*> get_field(
+  const map<string, JsonValue>& obj, const string& key)
+{
+  auto it = obj.find(key);
+  if (it == obj.end()) {
+    return Error::format("Opening book entry is missing $", key);
+  }
+  const T* value = get_if<T>(&it->second._value);
+  if (value == nullptr) {
+    return Error::format(
+      "Opening book entry has an unexpected $: $",
+      key,
+      it->second.what_alternative());
+  }
+  return value;
+}
+
+OrError<OpeningBookEntry> entry_of_json(const JsonValue& value)
+{
+  const auto* obj = get_if<map<string, JsonValue>>(&value._value);
+  if (obj == nullptr) { return Error("Opening book entry is not an object"); }
+
+  bail(guess, get_field<string>(*obj, "guess"));
+  bail(num_guesses, get_field<int>(*obj, "num_guesses"));
+  bail(is_optimal, get_field<string>(*obj, "is_optimal"));
+  bail(num_secrets, get_field<int>(*obj, "num_secrets"));
+  bail(total_guesses, get_field<int>(*obj, "total_guesses"));
+  bail(worst_num_guesses, get_field<int>(*obj, "worst_num_guesses"));
+  bail(max_depth, get_field<int>(*obj, "max_depth"));
+  bail(all_matches, get_field<vector<JsonValue>>(*obj, "all_matches"));
+  if (*num_secrets <= 0) {
+    return Error("Opening book entry has no secrets");
+  }
+
+  OpeningBookEntry entry;
+  entry.num_secrets = *num_secrets;
+  entry.search = SearchResult{
+    .best_guess = InternalString(*guess),
+    .num_guesses = *num_guesses,
+    .is_optimal = *is_optimal == "true",
+  };
+  entry.info.first_guess = entry.search.best_guess;
+  entry.info.avg_guesses = double(*total_guesses) / *num_secrets;
+  entry.info.worst_num_guesses = *worst_num_guesses;
+  entry.info.max_depth = *max_depth;
+  entry.info.can_stop = true;
+  for (const auto& m : *all_matches) {
+    const auto* str = get_if<string>(&m._value);
+    if (str == nullptr) {
+      return Error("Opening book pattern is not a string");
+    }
+    bail(match, Match::parse(*str));
+    entry.info.all_matches.push_back(match);
+  }
+  return entry;
+}
+
+} // namespace
+
+string OpeningBook::key(const GameStateView& game_state)
+{
+  static const vector<InternalString> no_guesses;
+  return hash_game_state(
+    game_state.is_hard_mode() ? game_state.allowed_guesses() : no_guesses,
+    game_state.possible_secrets(),
+    game_state.is_hard_mode());
+}
+
+void OpeningBook::add(const GameState& game_state, OpeningBookEntry entry)
+{
+  entry.num_secrets = game_state.possible_secrets().size();
+  _num_secrets.insert(entry.num_secrets);
+  _entries[key(game_state)] = move(entry);
+}
+
+const OpeningBookEntry* OpeningBook::find(const GameStateView& game_state) const
+{
+  if (_num_secrets.count(game_state.possible_secrets().size()) == 0) {
+    return nullptr;
+  }
+  auto it = _entries.find(key(game_state));
+  if (it == _entries.end()) return nullptr;
+  return &it->second;
+}
+
+int OpeningBook::size() const { return _entries.size(); }
+
+JsonValue OpeningBook::to_json() const
+{
+  map<string, JsonValue> obj;
+  for (const auto& [key, entry] : _entries) {
+    const auto& info = entry.info;
+    obj.emplace(
+      key,
+      json::to_json(map<string, JsonValue>{
+        {"guess", json::to_json(entry.search.best_guess)},
+        {"num_guesses", json::to_json(entry.search.num_guesses)},
+        {"is_optimal", json::to_json(entry.search.is_optimal)},
+        {"num_secrets", json::to_json(entry.num_secrets)},
+        {"total_guesses",
+         json::to_json(int(lround(info.avg_guesses * entry.num_secrets)))},
+        {"worst_num_guesses", json::to_json(info.worst_num_guesses)},
+        {"max_depth", json::to_json(info.max_depth)},
+        {"all_matches", json::to_json(info.all_matches)},
+      }));
+  }
+  return json::to_json(obj);
+}
+
+OrError<OpeningBook> OpeningBook::of_json(const JsonValue& value)
+{
+  const auto* obj = get_if<map<string, JsonValue>>(&value._value);
+  if (obj == nullptr) { return Error("Opening book is not an object"); }
+
+  OpeningBook book;
+  for (const auto& [key, entry_json] : *obj) {
+    bail(entry, entry_of_json(entry_json));
+    book._num_secrets.insert(entry.num_secrets);
+    book._entries.emplace(key, move(entry));
+  }
+  return book;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "game_state.hpp"
+#include "greedy.hpp"
+#include "simulator.hpp"
+#include "utils/error.hpp"
+#include "utils/json.hpp"
+
+struct OpeningBookEntry {
+  // What Engine::search found for the state
+  SearchResult search;
+  // The simulation of the guess found
+  WordInfo info;
+  // Of the state, set by OpeningBook::add
+  int num_secrets = 0;
+};
+
+// Second moves computed offline for every pattern of the best first guesses,
+// keyed by OpeningBook::key of the state after the first guess.
+//
+// In JSON it's an object from the key to {"guess", "num_guesses",
+// "is_optimal", "num_secrets", "total_guesses", "worst_num_guesses",
+// "max_depth", "all_matches"}. The average is stored as the total over all
+// secrets since the JSON parser only reads integers.
+struct OpeningBook {
+ public:
+  // The hash of the possible secrets, and of the allowed guesses in hard
+  // mode only. A book holds the states after the first guess of one root
+  // state, so in easy mode the allowed guesses are the root's whether or not
+  // useless guesses were dropped, and how they were dropped depends on their
+  // order.
+  static std::string key(const GameStateView& game_state);
+
+  void add(const GameState& game_state, OpeningBookEntry entry);
+
+  // Cheap when the book has no state with as many secrets, the state is only
+  // hashed otherwise.
+  const OpeningBookEntry* find(const GameStateView& game_state) const;
+
+  int size() const;
+
+  json::JsonValue to_json() const;
+
+  static OrError<OpeningBook> of_json(const json::JsonValue& value);
+
+ private:
+  std::map<std::string, OpeningBookEntry> _entries;
+  std::set<size_t> _num_secrets;
+};
@@ -0,0 +1,51 @@
+#include "search_budget.hpp"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// CancellationToken
+//
+
+CancellationToken::CancellationToken()
+    : _cancelled(make_shared<atomic<bool>>(false))
+{}
+
+CancellationToken::~CancellationToken() {}
+
+void CancellationToken::cancel() const { _cancelled->store(true); }
+
+void CancellationToken::reset() const { _cancelled->store(false); }
+
+bool CancellationToken::is_cancelled() const { return _cancelled->load(); }
+
+////////////////////////////////////////////////////////////////////////////////
+// SearchBudget
+//
+
+SearchBudget::SearchBudget() {}
+
+SearchBudget::SearchBudget(
+  optional<clock::time_point> deadline, optional<CancellationToken> token)
+    : _deadline(deadline), _token(move(token))
+{}
+
+SearchBudget::~SearchBudget() {}
+
+SearchBudget SearchBudget::unlimited() { return SearchBudget(); }
+
+SearchBudget SearchBudget::with_timeout(
+  clock::duration timeout, optional<CancellationToken> token)
+{
+  return SearchBudget(clock::now() + timeout, move(token));
+}
+
+bool SearchBudget::check()
+{
+  if (_exhausted) { return true; }
+  if (
+    (_token.has_value() && _token->is_cancelled()) ||
+    (_deadline.has_value() && clock::now() >= *_deadline)) {
+    _exhausted = true;
+  }
+  return _exhausted;
+}
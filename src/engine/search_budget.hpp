@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+// Shared flag to ask searches running elsewhere to stop. Setting it is a
+// single lock free store, so it is fine to cancel from a signal handler.
+struct CancellationToken {
+ public:
+  CancellationToken();
+  ~CancellationToken();
+
+  void cancel() const;
+  void reset() const;
+  bool is_cancelled() const;
+
+ private:
+  std::shared_ptr<std::atomic<bool>> _cancelled;
+};
+
+// Limits how long a search may run. Engines poll it once per search node and
+// unwind as soon as it runs out, the search then fails.
+struct SearchBudget {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  SearchBudget();
+  SearchBudget(
+    std::optional<clock::time_point> deadline,
+    std::optional<CancellationToken> token);
+  ~SearchBudget();
+
+  static SearchBudget unlimited();
+  static SearchBudget with_timeout(
+    clock::duration timeout,
+    std::optional<CancellationToken> token = std::nullopt);
+
+  // Only looks at the clock and the token every few calls. Once the budget is
+  // exhausted it stays that way.
+  bool poll()
+  {
+    if (_exhausted) { return true; }
+    if (++_num_polls % _poll_interval != 0) { return false; }
+    return check();
+  }
+
+  bool check();
+
+  bool is_exhausted() const { return _exhausted; }
+
+ private:
+  constexpr static uint32_t _poll_interval = 64;
+
+  std::optional<clock::time_point> _deadline;
+  std::optional<CancellationToken> _token;
+  bool _exhausted = false;
+  uint32_t _num_polls = 0;
+};
@@ -0,0 +1,9 @@
+#include "search_engine.hpp"
+
+SearchEngine::~SearchEngine() {}
+
+void SearchEngine::set_budget(const SearchBudget& budget) { _budget = budget; }
+
+bool SearchEngine::budget_exhausted() const { return _budget.is_exhausted(); }
+
+bool SearchEngine::check_budget() { return _budget.check(); }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+
+#include "game_state.hpp"
+#include "greedy.hpp"
+#include "search_budget.hpp"
+#include "utils/error.hpp"
+
+// Something that picks the next guess for a game state, the simulator works
+// with any of them.
+struct SearchEngine {
+ public:
+  virtual ~SearchEngine();
+
+  // Fails when the budget runs out during the search, whatever was found by
+  // then isn't an answer. budget_exhausted tells it apart from other errors.
+  virtual OrError<SearchResult> search(
+    const GameStateView& game_state, int max_depth) = 0;
+
+  // A new engine with the same settings, caches and budget, for searching
+  // from another thread.
+  virtual std::unique_ptr<SearchEngine> fork() const = 0;
+
+  void set_budget(const SearchBudget& budget);
+
+  // Whether the last search was cut short by the budget, and so failed
+  bool budget_exhausted() const;
+
+  // Checks the budget right away rather than waiting for the next poll, for
+  // when the search happened on a fork.
+  bool check_budget();
+
+ protected:
+  SearchBudget _budget;
+};
@@ -0,0 +1,100 @@
+#include "simulation_cache.hpp"
+
+#include "simulator.hpp"
+#include "utils/format.hpp"
+
+#include <random>
+
+using namespace std;
+
+namespace {
+
+vector<CacheKey> init_word_hashes(uint64_t seed)
+{
+  vector<CacheKey> word_hashes;
+  word_hashes.resize(InternalString::max_id());
+
+  std::mt19937_64 rng(seed);
+  for (auto& h : word_hashes) {
+    h.lower_hash = rng();
+    h.upper_hash = rng();
+  }
+  return word_hashes;
+}
+
+} // namespace
+
+SimulationCache::SimulationCache(size_t max_size)
+    : _max_size(max(size_t(1), max_size / _cache_segments)),
+      _secret_hashes(init_word_hashes(7)),
+      _allowed_hashes(init_word_hashes(11))
+{}
+
+SimulationCache::~SimulationCache() {}
+
+CacheKey SimulationCache::secrets_key(const WordList& possible_secrets)
+{
+  CacheKey key;
+  for (const auto w : possible_secrets) { key ^= _secret_hashes.at(w.id()); }
+  return key;
+}
+
+CacheKey SimulationCache::allowed_key(
+  const WordList& allowed_guesses, bool hard_mode)
+{
+  CacheKey key{.lower_hash = hard_mode, .upper_hash = 0};
+  for (const auto w : allowed_guesses) { key ^= _allowed_hashes.at(w.id()); }
+  return key;
+}
+
+shared_ptr<const SimNode> SimulationCache::find(const CacheKey& key)
+{
+  size_t segment = key.lower_hash % _cache_segments;
+  shared_ptr<const SimNode> node;
+  {
+#ifdef _SHARED_CACHES
+    lock_guard<mutex> lock(_mutex[segment]);
+#endif
+    auto& c = _cache[segment];
+    auto it = c.find(key);
+    if (it != c.end()) { node = it->second; }
+  }
+  if (node != nullptr) {
+    _hits++;
+  } else {
+    _misses++;
+  }
+  return node;
+}
+
+void SimulationCache::insert(
+  const CacheKey& key, shared_ptr<const SimNode> node)
+{
+  size_t segment = key.lower_hash % _cache_segments;
+#ifdef _SHARED_CACHES
+  lock_guard<mutex> lock(_mutex[segment]);
+#endif
+  auto& c = _cache[segment];
+  if (c.size() >= _max_size) {
+    size_t counter = 0;
+    for (auto it = c.begin(); it != c.end();) {
+      if ((counter++) % 2 == 0) {
+        it = c.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  c[key] = move(node);
+}
+
+void SimulationCache::debug() const
+{
+  size_t size = 0;
+  for (const auto& c : _cache) { size += c.size(); }
+  fmt::print_line(
+    "Simulation cache: subtrees:$ hits:$ misses:$",
+    size,
+    _hits.load(),
+    _misses.load());
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "cache.hpp"
+#include "game_state.hpp"
+
+struct SimNode;
+
+// Proven subtrees found by simulations, keyed by the possible secrets and
+// allowed guesses of the state they start from. Different first guesses often
+// lead to the same states, simulators sharing a cache splice those subtrees in
+// instead of searching and walking them again. Only proven subtrees are
+// stored, they are valid at any depth, but they depend on the objective of the
+// engine, so simulators sharing a cache must use the same kind of engine.
+struct SimulationCache {
+ public:
+  SimulationCache(size_t max_size);
+  ~SimulationCache();
+
+  // The key of a state is the xor of these two, the allowed guesses are
+  // shared by many states in easy mode so their key can be reused
+  CacheKey secrets_key(const WordList& possible_secrets);
+  CacheKey allowed_key(const WordList& allowed_guesses, bool hard_mode);
+
+  std::shared_ptr<const SimNode> find(const CacheKey& key);
+  void insert(const CacheKey& key, std::shared_ptr<const SimNode> node);
+
+  void debug() const;
+
+ private:
+  constexpr static size_t _cache_segments = 1 << 12;
+
+  size_t _max_size;
+
+  std::vector<CacheKey> _secret_hashes;
+  std::vector<CacheKey> _allowed_hashes;
+
+  std::array<
+    std::unordered_map<
+      CacheKey,
+      std::shared_ptr<const SimNode>,
+      CacheKey::Hasher>,
+    _cache_segments>
+    _cache;
+
+#ifdef _SHARED_CACHES
+  std::array<std::mutex, _cache_segments> _mutex;
+#endif
+
+  std::atomic<size_t> _hits = 0;
+  std::atomic<size_t> _misses = 0;
+};
@@ -1,91 +1,353 @@
 #include "simulator.hpp"
 
+#include "simulation_cache.hpp"
 #include "utils/format.hpp"
 #include "utils/format_vector.hpp"
+#include "utils/small_hash.hpp"
 
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <set>
+
+#ifdef _DESKTOP
+#include <omp.h>
+#endif
 
 using namespace fmt;
 using namespace std;
 
 namespace {
 
-struct SecretInfo {
-  InternalString secret;
-  int num_guesses;
-};
+// Smaller subtrees are cheaper to simulate than to look up
+constexpr size_t min_cached_secrets = 3;
+
+uint64_t state_fingerprint(const GameState& game_state)
+{
+  uint64_t fp = hash64(game_state.is_hard_mode());
+  for (const auto word : game_state.allowed_guesses()) {
+    fp = hash64(fp ^ word.id());
+  }
+  fp = hash64(fp ^ game_state.possible_secrets().size());
+  for (const auto word : game_state.possible_secrets()) {
+    fp = hash64(fp ^ word.id());
+  }
+  return fp;
+}
+
+using PrevChildren = array<shared_ptr<const SimNode>, 256>;
+
+PrevChildren prev_children_of(const SimNode* prev, InternalString guess)
+{
+  PrevChildren prev_children;
+  if (prev != nullptr && prev->guess == guess) {
+    for (const auto& child : prev->children) {
+      prev_children[child.first.code()] = child.second;
+    }
+  }
+  return prev_children;
+}
 
 struct SimContext {
  public:
-  SimContext(Engine& engine, int max_depth)
-      : _engine(engine), _max_depth(max_depth)
+  SimContext(
+    SearchEngine& engine,
+    SimulationCache* simulation_cache,
+    bool keep_tree,
+    int max_depth)
+      : _engine(engine),
+        _simulation_cache(keep_tree ? nullptr : simulation_cache),
+        _keep_tree(keep_tree),
+        _max_depth(max_depth)
   {}
 
-  OrError<Unit> simulate_rec(
-    InternalString guess, const GameState& game_state, int num_guesses)
+  // Simulates the tree under guess. Subtrees of prev, the tree simulated for
+  // the same state at a previous depth, are reused where they were proven.
+  OrError<shared_ptr<SimNode>> simulate_rec(
+    InternalString guess,
+    const GameStateView& game_state,
+    const SimNode* prev,
+    bool is_root)
   {
-    num_guesses++;
-    array<Partition, 256> buckets = game_state.partition_by_pattern(guess);
+    auto prev_children = prev_children_of(prev, guess);
+
+    auto node = make_shared<SimNode>();
+    node->guess = guess;
+    node->is_proven = true;
 
+    array<Partition, 256> buckets = game_state.partition_by_pattern(guess);
     for (const auto& b : buckets) {
       if (b.is_empty()) continue;
+      if (is_root) { _all_matches.insert(b.match()); }
+      bail_unit(simulate_bucket(
+        *node, game_state, b, prev_children[b.match().code()]));
+    }
+    return node;
+  }
 
-      if (num_guesses == 1) { _all_matches.insert(b.match()); }
-
-      GameState next_state = game_state.state_from_partition(b);
-
-      if (next_state.possible_secrets().size() == 1) {
-        InternalString only_secret = next_state.possible_secrets()[0];
+  // Simulates the games where the node's guess got the bucket's pattern and
+  // adds them to the node.
+  OrError<Unit> simulate_bucket(
+    SimNode& node,
+    const GameStateView& game_state,
+    const Partition& bucket,
+    const shared_ptr<const SimNode>& prev_child)
+  {
+    GameStateView next_state = game_state.view_from_partition(bucket);
+
+    if (next_state.possible_secrets().size() == 1) {
+      InternalString only_secret = next_state.possible_secrets()[0];
+      node.output.emplace_back(SecretInfo{
+        .secret = only_secret,
+        .num_guesses = node.guess == only_secret ? 1 : 2,
+      });
+      return unit;
+    }
 
-        int ng = num_guesses;
-        if (guess != only_secret) { ng++; }
+    if (prev_child != nullptr && prev_child->is_proven) {
+      _num_reused++;
+      add_child(node, *prev_child);
+      node.children.emplace_back(bucket.match(), prev_child);
+      return unit;
+    }
 
-        _output.emplace_back(
-          SecretInfo{.secret = only_secret, .num_guesses = ng});
-        continue;
+    optional<CacheKey> cache_key;
+    if (
+      _simulation_cache != nullptr &&
+      next_state.possible_secrets().size() >= min_cached_secrets) {
+      cache_key =
+        _simulation_cache->secrets_key(next_state.possible_secrets()) ^
+        allowed_key(next_state);
+      auto cached = _simulation_cache->find(*cache_key);
+      if (cached != nullptr) {
+        add_child(node, *cached);
+        node.children.emplace_back(bucket.match(), move(cached));
+        return unit;
       }
+    }
 
-      bail(search_result, _engine.search(next_state, _max_depth));
-      if (!search_result.is_optimal) { _can_stop = false; }
-      bail_unit(
-        simulate_rec(search_result.best_guess, next_state, num_guesses));
+    bail(search_result, _engine.search(next_state, _max_depth));
+    bail(
+      child,
+      simulate_rec(
+        search_result.best_guess, next_state, prev_child.get(), false));
+    child->is_proven = child->is_proven && search_result.is_optimal;
+    add_child(node, *child);
+    if (_keep_tree) {
+      // Nothing gets dropped, the cache isn't used either since its
+      // subtrees don't have their children
+    } else if (child->is_proven) {
+      child->children.clear();
+      if (cache_key.has_value()) {
+        _simulation_cache->insert(*cache_key, child);
+      }
+    } else {
+      // Only proven subtrees get reused, so only their outputs are kept
+      child->output.clear();
     }
+    node.children.emplace_back(bucket.match(), move(child));
     return unit;
   }
 
-  const vector<SecretInfo>& output() const { return _output; }
+  void add_child(SimNode& node, const SimNode& child)
+  {
+    node.is_proven = node.is_proven && child.is_proven;
+    for (const auto& info : child.output) {
+      node.output.emplace_back(SecretInfo{
+        .secret = info.secret,
+        .num_guesses = info.num_guesses + 1,
+      });
+    }
+  }
+
+  void merge(SimNode& node, const SimNode& other)
+  {
+    node.is_proven = node.is_proven && other.is_proven;
+    node.output.insert(
+      node.output.end(), other.output.begin(), other.output.end());
+    node.children.insert(
+      node.children.end(), other.children.begin(), other.children.end());
+  }
+
+  void merge_stats(const SimContext& other)
+  {
+    _all_matches.insert(other._all_matches.begin(), other._all_matches.end());
+    _num_reused += other._num_reused;
+  }
+
+  void add_match(Match match) { _all_matches.insert(match); }
 
   const set<Match>& all_matches() const { return _all_matches; }
 
-  bool can_stop() const { return _can_stop; }
+  int num_reused() const { return _num_reused; }
 
  private:
-  Engine& _engine;
-  vector<SecretInfo> _output;
+  CacheKey allowed_key(const GameStateView& game_state)
+  {
+    // In easy mode every state shares the same list
+    if (&game_state.allowed_guesses() != _last_allowed_guesses) {
+      _last_allowed_guesses = &game_state.allowed_guesses();
+      _last_allowed_key = _simulation_cache->allowed_key(
+        game_state.allowed_guesses(), game_state.is_hard_mode());
+    }
+    return _last_allowed_key;
+  }
+
+  SearchEngine& _engine;
+  SimulationCache* _simulation_cache;
+  const bool _keep_tree;
+  const WordList* _last_allowed_guesses = nullptr;
+  CacheKey _last_allowed_key;
   set<Match> _all_matches;
   const int _max_depth;
-  bool _can_stop = true;
+  int _num_reused = 0;
 };
 
+bool can_run_parallel()
+{
+#ifdef _DESKTOP
+  return omp_get_active_level() < omp_get_max_active_levels();
+#else
+  return false;
+#endif
+}
+
+// Same as sim_ctx.simulate_rec(first_guess, game_state, prev, true), but with
+// each pattern of the first guess being a separate task. Nodes are merged in
+// pattern order, so the result doesn't depend on scheduling. Uses OpenMP's
+// default number of threads unless num_threads is positive.
+OrError<shared_ptr<SimNode>> simulate_parallel(
+  SearchEngine& engine,
+  SimulationCache* simulation_cache,
+  bool keep_tree,
+  SimContext& sim_ctx,
+  InternalString first_guess,
+  const GameStateView& game_state,
+  const SimNode* prev,
+  int max_depth,
+  [[maybe_unused]] int num_threads)
+{
+  auto prev_children = prev_children_of(prev, first_guess);
+
+  array<Partition, 256> buckets = game_state.partition_by_pattern(first_guess);
+
+  vector<const Partition*> tasks;
+  for (const auto& b : buckets) {
+    if (b.is_empty()) continue;
+    sim_ctx.add_match(b.match());
+    tasks.push_back(&b);
+  }
+  // Biggest buckets first, they take the longest
+  vector<int> order(tasks.size());
+  for (size_t i = 0; i < order.size(); i++) { order[i] = i; }
+  stable_sort(order.begin(), order.end(), [&](int t1, int t2) {
+    return tasks[t1]->size() > tasks[t2]->size();
+  });
+
+  vector<unique_ptr<SearchEngine>> engines(tasks.size());
+  vector<unique_ptr<SimContext>> contexts(tasks.size());
+  vector<SimNode> partial_nodes(tasks.size());
+  vector<optional<Error>> errors(tasks.size());
+
+#ifdef _DESKTOP
+  if (num_threads <= 0) { num_threads = omp_get_max_threads(); }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+#endif
+  for (size_t i = 0; i < order.size(); i++) {
+    const int t = order[i];
+    engines[t] = engine.fork();
+    contexts[t] = make_unique<SimContext>(
+      *engines[t], simulation_cache, keep_tree, max_depth);
+    auto& partial = partial_nodes[t];
+    partial.guess = first_guess;
+    partial.is_proven = true;
+    auto res = contexts[t]->simulate_bucket(
+      partial,
+      game_state,
+      *tasks[t],
+      prev_children[tasks[t]->match().code()]);
+    if (res.is_error()) { errors[t] = res.error(); }
+  }
+
+  auto node = make_shared<SimNode>();
+  node->guess = first_guess;
+  node->is_proven = true;
+  for (size_t t = 0; t < tasks.size(); t++) {
+    if (errors[t].has_value()) {
+      engine.check_budget();
+      return *errors[t];
+    }
+    sim_ctx.merge(*node, partial_nodes[t]);
+    sim_ctx.merge_stats(*contexts[t]);
+  }
+  return node;
+}
+
 } // namespace
 
-Simulator::Simulator(Engine& engine) : _engine(engine) {}
+Simulator::Simulator(SearchEngine& engine) : _engine(engine) {}
 
 Simulator::~Simulator() {}
 
+void Simulator::set_parallel(bool parallel, int num_threads)
+{
+  _parallel = parallel;
+  _num_threads = num_threads;
+}
+
+void Simulator::set_simulation_cache(SimulationCache& simulation_cache)
+{
+  _simulation_cache = &simulation_cache;
+}
+
+void Simulator::forget(InternalString first_guess)
+{
+  _trees.erase(first_guess);
+}
+
 OrError<WordInfo> Simulator::simulate(
   const GameState& game_state, InternalString first_guess, int max_depth)
 {
   assert(max_depth > 0);
-  SimContext sim_ctx(_engine, max_depth);
-  bail_unit(sim_ctx.simulate_rec(first_guess, game_state, 0));
+
+  auto fingerprint = state_fingerprint(game_state);
+  if (fingerprint != _state_fingerprint) {
+    _trees.clear();
+    _state_fingerprint = fingerprint;
+  }
+  const SimNode* prev = nullptr;
+  {
+    auto it = _trees.find(first_guess);
+    if (it != _trees.end()) { prev = it->second.get(); }
+  }
+
+  SimContext sim_ctx(_engine, _simulation_cache, _keep_tree, max_depth);
+  shared_ptr<SimNode> root;
+  if (_parallel && can_run_parallel()) {
+    bail_assign(
+      root,
+      simulate_parallel(
+        _engine,
+        _simulation_cache,
+        _keep_tree,
+        sim_ctx,
+        first_guess,
+        game_state,
+        prev,
+        max_depth,
+        _num_threads));
+  } else {
+    bail_assign(
+      root, sim_ctx.simulate_rec(first_guess, game_state, prev, true));
+  }
+  _num_reused += sim_ctx.num_reused();
 
   int worst_num_guesses = 0;
   int sum_num_guesses = 0;
   map<int, int> distribution;
   optional<InternalString> most_difficult_secret;
 
-  for (const auto& info : sim_ctx.output()) {
+  for (const auto& info : root->output) {
     int num_guesses = info.num_guesses;
     if (num_guesses > worst_num_guesses) {
       worst_num_guesses = num_guesses;
@@ -105,6 +367,15 @@ OrError<WordInfo> Simulator::simulate(
   vector<Match> all_matches_v;
   for (const auto m : sim_ctx.all_matches()) { all_matches_v.push_back(m); }
 
+  const bool can_stop = root->is_proven;
+  if (_keep_tree) { _last_tree = root; }
+  if (can_stop) {
+    _trees.erase(first_guess);
+  } else {
+    if (!_keep_tree) { root->output.clear(); }
+    _trees[first_guess] = move(root);
+  }
+
   return WordInfo{
     .first_guess = first_guess,
     .avg_guesses =
@@ -115,16 +386,37 @@ OrError<WordInfo> Simulator::simulate(
     .most_difficult_secret = *most_difficult_secret,
     .max_depth = max_depth,
     .all_matches = move(all_matches_v),
-    .can_stop = sim_ctx.can_stop(),
+    .can_stop = can_stop,
   };
 }
 
+int Simulator::num_reused_subtrees() const { return _num_reused; }
+
+void Simulator::set_keep_tree(bool keep_tree) { _keep_tree = keep_tree; }
+
+shared_ptr<const SimNode> Simulator::last_tree() const { return _last_tree; }
+
 ////////////////////////////////////////////////////////////////////////////////
 // WordInfo
 //
 
 WordInfo::~WordInfo() {}
 
+bool is_better_than(const WordInfo& info1, const WordInfo& info2)
+{
+  if (info1.avg_guesses != info2.avg_guesses) {
+    return info1.avg_guesses < info2.avg_guesses;
+  } else if (info1.worst_num_guesses != info2.worst_num_guesses) {
+    return info1.worst_num_guesses < info2.worst_num_guesses;
+  } else if (info1.max_depth != info2.max_depth) {
+    return info1.max_depth > info2.max_depth;
+  } else if (info1.first_guess != info2.first_guess) {
+    return info1.first_guess.str() < info2.first_guess.str();
+  } else {
+    return false;
+  }
+}
+
 namespace json {
 
 JsonValue to_json_t<WordInfo>::convert(const WordInfo& value)
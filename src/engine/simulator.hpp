@@ -1,11 +1,12 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <vector>
 
-#include "engine.hpp"
 #include "engine/game_state.hpp"
 #include "internal_string.hpp"
+#include "search_engine.hpp"
 #include "utils/to_json.hpp"
 
 struct WordInfo {
@@ -24,17 +25,77 @@ struct WordInfo {
   ~WordInfo();
 };
 
+// Order of strategies, best first
+bool is_better_than(const WordInfo& info1, const WordInfo& info2);
+
+struct SimulationCache;
+
+struct SecretInfo {
+  InternalString secret;
+  int num_guesses;
+};
+
+// Decision tree found by a simulation below one guess. The num_guesses of
+// the outputs count this node's guess as the first one.
+struct SimNode {
+  InternalString guess;
+
+  // Whether the guess and every guess below it were picked by optimal
+  // searches, simulating at a greater depth wouldn't change anything.
+  bool is_proven;
+
+  // Only kept for proven nodes and the root while it's being built
+  std::vector<SecretInfo> output;
+
+  // Subtrees with more than one secret, only kept while not proven
+  std::vector<std::pair<Match, std::shared_ptr<const SimNode>>> children;
+};
+
 struct Simulator {
  public:
-  Simulator(Engine& engine);
+  Simulator(SearchEngine& engine);
 
   ~Simulator();
 
   OrError<WordInfo> simulate(
     const GameState& game_state, InternalString first_guess, int max_depth);
 
+  // When set, the subtrees under each pattern of the first guess are
+  // simulated in parallel, each with a fork of the engine. Only takes effect
+  // outside of other parallel regions, unless nesting is enabled. When
+  // positive, num_threads is how many threads share the patterns.
+  void set_parallel(bool parallel, int num_threads = 0);
+
+  // The simulator keeps the tree of each first guess it simulated for the
+  // current game state, so that simulating it again at a greater depth only
+  // searches the subtrees that weren't proven yet. Drops the tree of a word
+  // that won't be simulated again.
+  void forget(InternalString first_guess);
+
+  int num_reused_subtrees() const;
+
+  // Shares proven subtrees with other simulators using the same cache, which
+  // must outlive the simulator.
+  void set_simulation_cache(SimulationCache& simulation_cache);
+
+  // Keeps every node with its outputs and children, for writing the whole
+  // decision tree out. Costs more memory and doesn't use the simulation cache.
+  void set_keep_tree(bool keep_tree);
+
+  // The tree of the last simulation, only with keep_tree set
+  std::shared_ptr<const SimNode> last_tree() const;
+
  private:
-  Engine& _engine;
+  SearchEngine& _engine;
+  bool _parallel = false;
+  int _num_threads = 0;
+  SimulationCache* _simulation_cache = nullptr;
+  bool _keep_tree = false;
+  std::shared_ptr<const SimNode> _last_tree;
+
+  uint64_t _state_fingerprint = 0;
+  std::map<InternalString, std::shared_ptr<SimNode>> _trees;
+  int _num_reused = 0;
 };
 
 namespace json {
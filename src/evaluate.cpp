@@ -1,15 +1,27 @@
 #include "evaluate.hpp"
 
+#include <atomic>
 #include <chrono>
-#include <fstream>
+#include <limits>
+#include <omp.h>
+#include <queue>
 #include <set>
 
+#include "build_id.hpp"
+#include "engine/avg_engine.hpp"
+#include "engine/binary_format.hpp"
+#include "engine/binary_solutions.hpp"
+#include "engine/decision_tree.hpp"
 #include "engine/dictionary.hpp"
 #include "engine/engine.hpp"
 #include "engine/game_state.hpp"
+#include "engine/greedy.hpp"
 #include "engine/hash_game_state.hpp"
 #include "engine/match.hpp"
+#include "engine/opening_book.hpp"
+#include "engine/simulation_cache.hpp"
 #include "engine/simulator.hpp"
+#include "solution_file.hpp"
 #include "utils/command.hpp"
 #include "utils/error.hpp"
 #include "utils/format_map.hpp"
@@ -34,38 +46,94 @@ void print_word_info(const WordInfo& info, int idx, int max_words)
   print_line("Most difficult secret: $", info.most_difficult_secret);
 };
 
-bool is_better_than(const WordInfo& info1, const WordInfo& info2)
-{
-  if (info1.avg_guesses != info2.avg_guesses) {
-    return info1.avg_guesses < info2.avg_guesses;
-  } else if (info1.worst_num_guesses != info2.worst_num_guesses) {
-    return info1.worst_num_guesses < info2.worst_num_guesses;
-  } else if (info1.max_depth != info2.max_depth) {
-    return info1.max_depth > info2.max_depth;
-  } else if (info1.first_guess != info2.first_guess) {
-    return info1.first_guess.str() < info2.first_guess.str();
-  } else {
-    return false;
+// Once every word of the loop has started, the threads that finish have
+// nothing left to do. The words still running then split their next
+// simulations by pattern so that those threads join in.
+struct Stragglers {
+ public:
+  struct Running {
+   public:
+    Running(Stragglers& stragglers) : _stragglers(stragglers)
+    {
+      _stragglers._not_started--;
+      _stragglers._running++;
+    }
+    ~Running() { _stragglers._running--; }
+
+   private:
+    Stragglers& _stragglers;
+  };
+
+  Stragglers(int num_words)
+      : _num_threads(omp_get_max_threads()), _not_started(num_words)
+  {}
+
+  // How many threads the calling word should split its next simulation
+  // between, 0 when it shouldn't split it
+  int split_threads() const
+  {
+    if (_not_started > 0) return 0;
+    return max(1, _num_threads / max(1, _running.load()));
   }
-}
 
-OrError<WordInfo> run_word(
-  CachePair& cache_pair,
+ private:
+  const int _num_threads;
+  atomic<int> _not_started;
+  atomic<int> _running = 0;
+};
+
+struct Strategy {
+  WordInfo info;
+  // Only with the trees kept for the binary solutions
+  shared_ptr<const SimNode> tree;
+};
+
+// A single simulation with the engine that minimises the average number of
+// guesses directly, no need to go through increasing depths.
+OrError<Strategy> run_word_average(
+  Cache& cache,
+  SimulationCache* simulation_cache,
   const InternalString first_guess,
   const GameState& game_state,
-  bool verbose,
+  const AverageObjective& objective,
+  bool keep_tree,
+  const Stragglers& stragglers,
   int idx,
   int max_words)
 {
-  Engine engine(cache_pair, verbose);
-
+  AvgEngine engine(cache, objective.width);
   Simulator simulator(engine);
+  if (simulation_cache != nullptr) {
+    simulator.set_simulation_cache(*simulation_cache);
+  }
+  simulator.set_keep_tree(keep_tree);
+  const int split_threads = stragglers.split_threads();
+  simulator.set_parallel(split_threads > 0, split_threads);
+
+  bail(info, simulator.simulate(game_state, first_guess, objective.max_depth));
+
+#pragma omp critical
+  print_word_info(info, idx, max_words);
 
+  return Strategy{.info = move(info), .tree = simulator.last_tree()};
+}
+
+// Simulates the guess at increasing depths until it's proven, keeping the
+// best strategy found.
+OrError<Strategy> run_depths(
+  Simulator& simulator,
+  const InternalString first_guess,
+  const GameState& game_state,
+  bool verbose,
+  const Stragglers* stragglers)
+{
   optional<WordInfo> best_strategy;
+  shared_ptr<const SimNode> best_tree;
 
   auto update_strategy = [&](WordInfo&& info) {
     if (!best_strategy.has_value() || is_better_than(info, *best_strategy)) {
       best_strategy = move(info);
+      best_tree = simulator.last_tree();
     } else {
       best_strategy->avg_guesses = min(best_strategy->avg_guesses, info.avg_guesses);
       best_strategy->max_depth = max(best_strategy->max_depth, info.max_depth);
@@ -75,6 +143,9 @@ OrError<WordInfo> run_word(
   bool should_stop = false;
   for (int max_depth = 1; max_depth < 16 && !should_stop; ++max_depth) {
     if (verbose) { print_line("Running depth $", max_depth); }
+    const int split_threads =
+      stragglers != nullptr ? stragglers->split_threads() : 0;
+    if (split_threads > 0) { simulator.set_parallel(true, split_threads); }
     bail(info, simulator.simulate(game_state, first_guess, max_depth));
 
     if (info.can_stop) {
@@ -85,41 +156,251 @@ OrError<WordInfo> run_word(
     update_strategy(move(info));
   }
 
+  return Strategy{.info = *best_strategy, .tree = best_tree};
+}
+
+OrError<Strategy> run_word(
+  CachePair& cache_pair,
+  SimulationCache* simulation_cache,
+  const InternalString first_guess,
+  const GameState& game_state,
+  const WidthPolicy& width_policy,
+  bool verbose,
+  bool keep_tree,
+  const Stragglers& stragglers,
+  int idx,
+  int max_words)
+{
+  Engine engine(cache_pair, verbose, width_policy);
+
+  Simulator simulator(engine);
+  if (simulation_cache != nullptr) {
+    simulator.set_simulation_cache(*simulation_cache);
+  }
+  simulator.set_keep_tree(keep_tree);
+
+  bail(
+    strategy,
+    run_depths(simulator, first_guess, game_state, verbose, &stragglers));
+
 #pragma omp critical
-  print_word_info(*best_strategy, idx, max_words);
+  {
+    print_word_info(strategy.info, idx, max_words);
+    if (verbose) {
+      engine.debug();
+      print_line("Reused subtrees: $", simulator.num_reused_subtrees());
+    }
+  }
 
-  return *best_strategy;
+  return strategy;
 }
 
-OrError<Unit> evaluate(
-  GameState game_state,
-  bool verbose,
-  int max_words,
-  const string& solutions_cache_dir,
-  const optional<int>& solutions_max_words,
-  int cache_max_size)
+// States with fewer secrets are searched instantly anyway
+constexpr size_t min_book_secrets = 3;
+
+// The second move of a state, searched until proven like the engine would
+// and then simulated like a first guess
+OrError<OpeningBookEntry> book_entry(
+  CachePair& cache_pair,
+  SimulationCache* simulation_cache,
+  const GameState& game_state,
+  const WidthPolicy& width_policy)
+{
+  Engine engine(cache_pair, false, width_policy);
+  optional<SearchResult> search;
+  for (int max_depth = 1; max_depth < 16; ++max_depth) {
+    bail(result, engine.search(game_state, max_depth));
+    search = result;
+    if (result.is_optimal) break;
+  }
+
+  Simulator simulator(engine);
+  if (simulation_cache != nullptr) {
+    simulator.set_simulation_cache(*simulation_cache);
+  }
+  bail(
+    strategy,
+    run_depths(simulator, search->best_guess, game_state, false, nullptr));
+  return OpeningBookEntry{.search = *search, .info = move(strategy.info)};
+}
 
+OrError<OpeningBook> build_opening_book(
+  CachePair& cache_pair,
+  SimulationCache* simulation_cache,
+  const GameState& game_state,
+  const vector<InternalString>& first_guesses,
+  const WidthPolicy& width_policy)
 {
+  vector<GameState> states;
+  set<string> seen;
+  for (const auto first_guess : first_guesses) {
+    for (const auto& b : game_state.partition_by_pattern(first_guess)) {
+      if (b.size() < min_book_secrets) continue;
+      auto state = game_state.state_from_partition(b);
+      if (!seen.insert(OpeningBook::key(state)).second) continue;
+      states.push_back(move(state));
+    }
+  }
+  print_line(
+    "Building opening book for $ states after $ first guesses",
+    states.size(),
+    first_guesses.size());
+
+  vector<optional<OrError<OpeningBookEntry>>> entries(states.size());
+#pragma omp parallel for schedule(dynamic, 1)
+  for (size_t idx = 0; idx < states.size(); idx++) {
+    entries[idx] =
+      book_entry(cache_pair, simulation_cache, states[idx], width_policy);
+  }
+
+  OpeningBook book;
+  for (size_t idx = 0; idx < states.size(); idx++) {
+    bail(entry, *entries[idx]);
+    book.add(states[idx], move(entry));
+  }
+  return book;
+}
+
+} // namespace
+
+OrError<Unit> evaluate(
+  GameState game_state, const EvaluateOptions& options, EvaluateCaches& caches)
+{
+  if (
+    options.average_objective.has_value() && options.opening_book_words > 0) {
+    return Error(
+      "The opening book holds moves of the worst case engine, it can't be "
+      "built with the average objective");
+  }
+  if (options.resume && options.binary_trees) {
+    return Error(
+      "The progress log doesn't keep the trees of the words already done, "
+      "--resume can't write binary trees");
+  }
+  if (
+    options.shard.has_value() &&
+    (options.binary_solutions || options.opening_book_words > 0)) {
+    return Error(
+      "Shards only write partial solutions, the binary solutions and the "
+      "opening book need every first guess");
+  }
+
   game_state.sort_guesses_by_greedy(false);
 
-  max_words = min<int>(max_words, game_state.allowed_guesses().size());
+  const int max_words =
+    min<int>(options.max_words, game_state.allowed_guesses().size());
 
-  vector<optional<OrError<WordInfo>>> best_strategies_per_word(
+  vector<optional<OrError<Strategy>>> best_strategies_per_word(
     max_words, nullopt);
 
-  auto cache_pair = make_unique<CachePair>(cache_max_size);
+  auto& cache_pair = caches.cache_pair;
+  auto& avg_cache = caches.avg_cache;
+  auto& simulation_cache = caches.simulation_cache;
+
+  const SolutionFile solution_file(
+    options.solutions_dir, game_state.hash(), options.shard);
+
+  SolutionManifest manifest{
+    .build_id = build_id(),
+    .parameters = options.parameters(),
+    .complete = false,
+  };
+  if (options.skip_if_current || options.resume) {
+    bail(previous, solution_file.read_manifest());
+    if (
+      options.skip_if_current && previous.has_value() &&
+      previous->is_current(manifest.build_id, manifest.parameters)) {
+      print_line(
+        "Solutions are current according to $, skipping",
+        solution_file.manifest_path());
+      return unit;
+    }
+    // The progress log only holds words of the run the manifest is for
+    if (
+      options.resume &&
+      (!previous.has_value() ||
+       !previous->is_same_run(manifest.build_id, manifest.parameters))) {
+      return Error::format(
+        "Can't resume, $ is missing or was written by another build or with "
+        "other parameters",
+        solution_file.manifest_path());
+    }
+  }
+  bail_unit(solution_file.write_manifest(manifest));
+
+  vector<bool> is_done(max_words, false);
+  if (options.resume) {
+    bail(done, solution_file.read_progress());
+    map<InternalString, WordInfo> done_by_word;
+    for (auto& info : done) { done_by_word.emplace(info.first_guess, info); }
+    int num_done = 0;
+    for (int idx = 0; idx < max_words; idx++) {
+      auto it = done_by_word.find(game_state.allowed_guesses()[idx]);
+      if (it == done_by_word.end()) continue;
+      best_strategies_per_word[idx] =
+        OrError<Strategy>(Strategy{.info = it->second, .tree = nullptr});
+      is_done[idx] = true;
+      num_done++;
+    }
+    print_line(
+      "Resuming from $ with $ words already done",
+      solution_file.progress_path(),
+      num_done);
+  } else {
+    bail_unit(solution_file.clear_progress());
+  }
+
+  // Both files are for the state's allowed guesses before sorting
+  const WordList dictionary = binary_dictionary(game_state.allowed_guesses());
 
-  auto cache_key = game_state.hash();
+  auto write_binary = [&](const vector<WordInfo>& best_strategies) -> bool {
+    set<InternalString> written;
+    for (const auto& info : best_strategies) {
+      written.insert(info.first_guess);
+    }
+    vector<unique_ptr<DecisionTree>> trees;
+    map<InternalString, const DecisionTree*> tree_by_word;
+    for (const auto& w_or_error : best_strategies_per_word) {
+      if (!w_or_error.has_value() || w_or_error->is_error()) continue;
+      const auto& strategy = w_or_error->value();
+      if (strategy.tree == nullptr) continue;
+      if (written.count(strategy.info.first_guess) == 0) continue;
+      auto tree = DecisionTree::of_sim_node(*strategy.tree);
+      if (tree.is_error()) {
+        print_line("Failed to build tree: $", tree.error());
+        continue;
+      }
+      trees.push_back(move(tree.value()));
+      tree_by_word[strategy.info.first_guess] = trees.back().get();
+    }
+    auto contents = BinarySolutions::encode(
+      best_strategies,
+      tree_by_word,
+      dictionary,
+      game_state.possible_secrets().size());
+    if (contents.is_error()) {
+      print_line("Failed to encode binary solutions: $", contents.error());
+      return false;
+    }
+    auto res = solution_file.write_binary(contents.value());
+    if (res.is_error()) {
+      print_line("Failed to write binary solutions: $", res.error());
+      return false;
+    }
+    print_line("Wrote binary cache to file $", solution_file.binary_path());
+    return true;
+  };
 
-  auto write_snapshot = [&](bool show_top_strats) {
+  // Whether every file was written
+  auto write_snapshot = [&](bool is_final) -> bool {
     vector<WordInfo> best_strategies;
     for (const auto& w_or_error : best_strategies_per_word) {
       if (!w_or_error.has_value()) continue;
       if (w_or_error.value().is_error()) continue;
-      best_strategies.push_back(w_or_error.value().value());
+      best_strategies.push_back(w_or_error.value().value().info);
     }
     sort(best_strategies.begin(), best_strategies.end(), is_better_than);
-    if (show_top_strats) {
+    if (is_final) {
       print_line("========================================");
       print_line("Top best strategies by average guesses");
       int idx = 0;
@@ -131,31 +412,160 @@ OrError<Unit> evaluate(
     }
 
     if (
-      solutions_max_words.has_value() &&
-      best_strategies.size() > size_t(*solutions_max_words)) {
-      best_strategies.resize(*solutions_max_words);
+      options.solutions_max_words.has_value() &&
+      best_strategies.size() > size_t(*options.solutions_max_words)) {
+      best_strategies.resize(*options.solutions_max_words);
+    }
+
+    // Only complete shards are merged
+    if (options.shard.has_value()) {
+      if (!is_final) return true;
+      auto res = solution_file.write_partial(best_strategies);
+      if (res.is_error()) {
+        print_line("Failed to write partial solutions: $", res.error());
+        return false;
+      }
+      print_line(
+        "Wrote partial solutions to file $", solution_file.partial_path());
+      return true;
     }
-    auto json = json::to_json(best_strategies).to_string();
 
-    string path = format("$/$.json", solutions_cache_dir, cache_key);
-    ofstream f(path, ios::out);
-    f.write(json.data(), json.size());
-    assert(f.good() && "Failed to write cache");
-    print_line("Wrote cache to file $", path);
+    auto res = solution_file.write_json(best_strategies);
+    if (res.is_error()) {
+      print_line("Failed to write solutions: $", res.error());
+      return false;
+    }
+    print_line("Wrote cache to file $", solution_file.json_path());
+
+    return !options.binary_solutions || write_binary(best_strategies);
+  };
+
+  const bool prune = options.prune_first_words &&
+                     options.solutions_max_words.has_value() &&
+                     *options.solutions_max_words > 0;
+
+  // Screening, every first guess gets a lower bound on its average from the
+  // sizes of its first partition. Words are searched from the lowest bound and
+  // once there are enough solutions, a word is skipped when its bound, or the
+  // tighter one from the best second guesses, is worse than the last of them.
+  //
+  // Without pruning the words go from the most expensive instead, so that the
+  // run doesn't end with a single thread busy on a long word. With pruning
+  // those are mostly the words with the worst bounds that get skipped.
+  const int num_secrets = game_state.possible_secrets().size();
+  vector<double> lower_bounds(max_words);
+  vector<int64_t> costs(max_words);
+#pragma omp parallel for
+  for (int idx = 0; idx < max_words; idx++) {
+    const auto word = game_state.allowed_guesses()[idx];
+    lower_bounds[idx] =
+      double(total_guesses_lower_bound(word, game_state.possible_secrets())) /
+      num_secrets;
+    costs[idx] =
+      predicted_simulation_cost(word, game_state.possible_secrets());
+  }
+  // Shards take every n-th word of the greedy order, so that they get as
+  // many good and bad words
+  vector<int> search_order;
+  for (int idx = 0; idx < max_words; idx++) {
+    if (!options.shard.has_value() || options.shard->contains(idx)) {
+      search_order.push_back(idx);
+    }
+  }
+  const int num_words = search_order.size();
+  stable_sort(search_order.begin(), search_order.end(), [&](int i1, int i2) {
+    return prune ? lower_bounds[i1] < lower_bounds[i2]
+                 : costs[i1] > costs[i2];
+  });
+  Stragglers stragglers(num_words);
+  // Lets the last words split their simulations, only for the loop
+  const int prev_max_active_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(2);
+  // Averages of the best solutions_max_words words so far, worst on top
+  priority_queue<double> best_avgs;
+  atomic<double> prune_above = numeric_limits<double>::infinity();
+  atomic<int> num_pruned = 0;
+  auto add_avg = [&](double avg_guesses) {
+    if (!prune) return;
+    best_avgs.push(avg_guesses);
+    if (int(best_avgs.size()) > *options.solutions_max_words) {
+      best_avgs.pop();
+    }
+    if (int(best_avgs.size()) == *options.solutions_max_words) {
+      prune_above = best_avgs.top();
+    }
   };
+  for (const auto& w_or_error : best_strategies_per_word) {
+    if (!w_or_error.has_value() || w_or_error->is_error()) continue;
+    add_avg(w_or_error->value().info.avg_guesses);
+  }
 
   auto last_wrote_snapshot = chrono::system_clock::now();
+  atomic<bool> any_word_failed = false;
 
 #pragma omp parallel for schedule(dynamic, 1)
-  for (int idx = 0; idx < max_words; idx++) {
+  for (int rank = 0; rank < num_words; rank++) {
+    const int idx = search_order[rank];
+    Stragglers::Running running(stragglers);
+    if (is_done[idx]) continue;
     const auto word = game_state.allowed_guesses()[idx];
+    // Ties could still make it on the other criteria
+    auto is_pruned = [&](double lower_bound) {
+      return lower_bound > prune_above + 1e-9;
+    };
+    if (
+      is_pruned(lower_bounds[idx]) ||
+      (prune_above < numeric_limits<double>::infinity() &&
+       is_pruned(
+         double(two_guesses_lower_bound(
+           word,
+           game_state.allowed_guesses(),
+           game_state.possible_secrets(),
+           game_state.is_hard_mode())) /
+         num_secrets))) {
+      num_pruned++;
+      continue;
+    }
     auto result =
-      run_word(*cache_pair, word, game_state, verbose, idx, max_words);
-    if (result.is_error()) { print_line("Word failed: $", result.error()); }
+      options.average_objective.has_value()
+        ? run_word_average(
+            *avg_cache,
+            simulation_cache.get(),
+            word,
+            game_state,
+            *options.average_objective,
+            options.binary_trees,
+            stragglers,
+            idx,
+            max_words)
+        : run_word(
+            *cache_pair,
+            simulation_cache.get(),
+            word,
+            game_state,
+            options.width_policy,
+            options.verbose,
+            options.binary_trees,
+            stragglers,
+            idx,
+            max_words);
+    if (result.is_error()) {
+      print_line("Word failed: $", result.error());
+      any_word_failed = true;
+    }
     best_strategies_per_word[idx] = move(result);
 
 #pragma omp critical
     {
+      if (!best_strategies_per_word[idx]->is_error()) {
+        const auto& info = best_strategies_per_word[idx]->value().info;
+        auto res = solution_file.append_progress(info);
+        if (res.is_error()) {
+          print_line("Failed to log progress: $", res.error());
+        }
+        add_avg(info.avg_guesses);
+      }
+
       auto now = chrono::system_clock::now();
       auto since_last_write = now - last_wrote_snapshot;
       if (since_last_write > 1min) {
@@ -164,34 +574,164 @@ OrError<Unit> evaluate(
       }
     }
   }
+  omp_set_max_active_levels(prev_max_active_levels);
 
-  write_snapshot(true);
+  if (prune) {
+    print_line(
+      "Skipped $ of $ first guesses by their lower bound",
+      num_pruned.load(),
+      num_words);
+  }
 
-  return unit;
-} // namespace
+  const bool wrote_solutions = write_snapshot(true);
+  if (options.verbose && simulation_cache != nullptr) {
+    simulation_cache->debug();
+  }
 
-} // namespace
+  if (options.opening_book_words > 0) {
+    vector<WordInfo> best_strategies;
+    for (const auto& w_or_error : best_strategies_per_word) {
+      if (!w_or_error.has_value() || w_or_error->is_error()) continue;
+      best_strategies.push_back(w_or_error->value().info);
+    }
+    sort(best_strategies.begin(), best_strategies.end(), is_better_than);
+    vector<InternalString> first_guesses;
+    for (const auto& info : best_strategies) {
+      if (int(first_guesses.size()) >= options.opening_book_words) break;
+      first_guesses.push_back(info.first_guess);
+    }
 
-Command Evaluate::command()
+    bail(
+      book,
+      build_opening_book(
+        *cache_pair,
+        simulation_cache.get(),
+        game_state,
+        first_guesses,
+        options.width_policy));
+    bail_unit(solution_file.write_opening_book(book.to_json().to_string()));
+    print_line(
+      "Wrote opening book with $ states to $",
+      book.size(),
+      solution_file.opening_book_path());
+  }
+
+  if (wrote_solutions && !any_word_failed) {
+    manifest.complete = true;
+    bail_unit(solution_file.write_manifest(manifest));
+  }
+
+  return unit;
+}
+
+function<OrError<EvaluateOptions>()> EvaluateOptions::param(
+  CommandBuilder& builder)
 {
-  auto builder = CommandBuilder("Evaluate performance of the bot");
-  auto game_state_param = GameState::param(builder);
+  auto width_policy_param = WidthPolicy::param(builder);
+  auto average_objective = builder.no_arg("--average-objective");
+  auto average_max_depth =
+    builder.optional_with_default("--average-max-depth", int_flag, 8);
+  auto average_width =
+    builder.optional_with_default("--average-width", int_flag, 30);
   auto verbose = builder.no_arg("--verbose");
-  auto solutions_cache_dir =
-    builder.required("--write-solutions-dir", string_flag);
+  auto solutions_dir = builder.required("--write-solutions-dir", string_flag);
   auto solutions_max_words =
     builder.optional("--solutions-max-words", int_flag);
   auto max_words = builder.optional_with_default("--max-words", int_flag, 100);
   auto cache_max_size =
     builder.optional_with_default("--cache-max-size", int_flag, 1 << 26);
+  auto simulation_cache_max_size = builder.optional_with_default(
+    "--simulation-cache-max-size", int_flag, 1 << 20);
+  auto binary_solutions = builder.no_arg("--binary-solutions");
+  auto binary_trees = builder.no_arg("--binary-trees");
+  auto opening_book_words =
+    builder.optional_with_default("--opening-book-words", int_flag, 0);
+  auto resume = builder.no_arg("--resume");
+  auto shard = builder.optional("--shard", string_flag);
+  auto skip_if_current = builder.no_arg("--skip-if-current");
+  auto no_pruning = builder.no_arg("--no-pruning");
+
+  return [=]() -> OrError<EvaluateOptions> {
+    optional<Shard> parsed_shard;
+    if (shard->value().has_value()) {
+      bail_assign(parsed_shard, Shard::parse(*shard->value()));
+    }
+    return EvaluateOptions{
+      .width_policy = width_policy_param(),
+      .average_objective =
+        average_objective->value()
+          ? make_optional(AverageObjective{
+              .max_depth = max(1, average_max_depth->value()),
+              .width = max(1, average_width->value()),
+            })
+          : nullopt,
+      .verbose = verbose->value(),
+      .max_words = max_words->value(),
+      .solutions_dir = solutions_dir->value(),
+      .solutions_max_words = solutions_max_words->value(),
+      .cache_max_size = cache_max_size->value(),
+      .simulation_cache_max_size = simulation_cache_max_size->value(),
+      .binary_solutions = binary_solutions->value() || binary_trees->value(),
+      .binary_trees = binary_trees->value(),
+      .opening_book_words = opening_book_words->value(),
+      .resume = resume->value(),
+      .shard = parsed_shard,
+      .skip_if_current = skip_if_current->value(),
+      .prune_first_words = !no_pruning->value(),
+    };
+  };
+}
+
+map<string, string> EvaluateOptions::parameters() const
+{
+  map<string, string> out{
+    {"adaptive_width", format("$", width_policy.adaptive)},
+    {"progressive_width", format("$", width_policy.progressive)},
+    {"min_width", format("$", width_policy.min_width)},
+    {"max_width", format("$", width_policy.max_width)},
+    {"width_margin", format("$", width_policy.margin)},
+    {"progressive_initial_width",
+     format("$", width_policy.progressive_initial_width)},
+    {"max_words", format("$", max_words)},
+    {"solutions_max_words", format("$", solutions_max_words)},
+    {"cache_max_size", format("$", cache_max_size)},
+    {"simulation_cache_max_size", format("$", simulation_cache_max_size)},
+    {"binary_solutions", format("$", binary_solutions)},
+    {"binary_trees", format("$", binary_trees)},
+    {"opening_book_words", format("$", opening_book_words)},
+    {"prune_first_words", format("$", prune_first_words)},
+  };
+  if (average_objective.has_value()) {
+    out["average_max_depth"] = format("$", average_objective->max_depth);
+    out["average_width"] = format("$", average_objective->width);
+  }
+  return out;
+}
+
+EvaluateCaches::EvaluateCaches(const EvaluateOptions& options)
+{
+  if (options.average_objective.has_value()) {
+    avg_cache = make_unique<Cache>(options.cache_max_size);
+  } else {
+    cache_pair = make_unique<CachePair>(options.cache_max_size);
+  }
+  if (options.simulation_cache_max_size > 0) {
+    simulation_cache =
+      make_unique<SimulationCache>(options.simulation_cache_max_size);
+  }
+}
+
+EvaluateCaches::~EvaluateCaches() {}
+
+Command Evaluate::command()
+{
+  auto builder = CommandBuilder("Evaluate performance of the bot");
+  auto game_state_param = GameState::param(builder);
+  auto options_param = EvaluateOptions::param(builder);
   return builder.run([=]() -> OrError<Unit> {
     bail(game_state, game_state_param());
-    return evaluate(
-      move(game_state),
-      verbose->value(),
-      max_words->value(),
-      solutions_cache_dir->value(),
-      solutions_max_words->value(),
-      cache_max_size->value());
+    bail(options, options_param());
+    EvaluateCaches caches(options);
+    return evaluate(move(game_state), options, caches);
   });
 }
@@ -1,6 +1,71 @@
 #pragma once
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "engine/candidate_width.hpp"
+#include "engine/game_state.hpp"
+#include "solution_file.hpp"
 #include "utils/command.hpp"
+#include "utils/error.hpp"
+
+struct Cache;
+struct CachePair;
+struct SimulationCache;
+
+struct AverageObjective {
+  int max_depth;
+  int width;
+};
+
+// Everything evaluate takes besides the game state
+struct EvaluateOptions {
+  WidthPolicy width_policy;
+  std::optional<AverageObjective> average_objective;
+  bool verbose;
+  int max_words;
+  std::string solutions_dir;
+  std::optional<int> solutions_max_words;
+  int cache_max_size;
+  int simulation_cache_max_size;
+  bool binary_solutions;
+  bool binary_trees;
+  int opening_book_words;
+  bool resume;
+  std::optional<Shard> shard;
+  // Exit when the manifest says the solutions are complete and were made by
+  // the same build with the same parameters
+  bool skip_if_current;
+  // Skip first guesses whose lower bound can't make the solutions
+  bool prune_first_words;
+
+  // The ones that change the solutions, recorded in their manifest
+  std::map<std::string, std::string> parameters() const;
+
+  static std::function<OrError<EvaluateOptions>()> param(
+    CommandBuilder& builder);
+};
+
+// Entries are keyed by the words they're about, so game states with the same
+// allowed guesses can share them. In easy mode the keys also depend on the
+// allowed guesses, in hard mode they only depend on the secrets.
+struct EvaluateCaches {
+ public:
+  EvaluateCaches(const EvaluateOptions& options);
+  ~EvaluateCaches();
+
+  std::unique_ptr<CachePair> cache_pair;
+  std::unique_ptr<Cache> avg_cache;
+  std::unique_ptr<SimulationCache> simulation_cache;
+};
+
+// Simulates the first max_words guesses of the state and writes the best ones
+// to the solutions directory
+OrError<Unit> evaluate(
+  GameState game_state, const EvaluateOptions& options, EvaluateCaches& caches);
 
 struct Evaluate {
   static Command command();
@@ -0,0 +1,188 @@
+#include "evaluate_batch.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "engine/dictionary.hpp"
+#include "engine/game_state.hpp"
+#include "evaluate.hpp"
+#include "utils/command.hpp"
+#include "utils/error.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+// Easy mode searches every allowed guess at every node, in hard mode most of
+// them are eliminated by the first patterns.
+constexpr double easy_mode_cost_factor = 10;
+
+struct Configuration {
+  string allowed_guesses_file;
+  optional<string> possible_secrets_file;
+  bool hard_mode;
+
+  string name() const
+  {
+    return format(
+      "$ $ $",
+      allowed_guesses_file,
+      possible_secrets_file.value_or("-"),
+      hard_mode ? "hard" : "easy");
+  }
+};
+
+// Each line is the allowed guesses file, the possible secrets file or - for
+// none, and the modes to run it in, easy and/or hard. Anything after a # is a
+// comment.
+OrError<vector<Configuration>> parse_manifest(const string& path)
+{
+  ifstream file(path);
+  if (!file.is_open()) {
+    return Error::format("Failed to open manifest $", path);
+  }
+
+  vector<Configuration> configurations;
+  string line;
+  int line_number = 0;
+  while (getline(file, line)) {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    istringstream fields(line);
+    vector<string> words;
+    string word;
+    while (fields >> word) { words.push_back(word); }
+    if (words.empty()) continue;
+    if (words.size() < 3) {
+      return Error::format(
+        "$:$: expected a guesses file, a secrets file and modes",
+        path,
+        line_number);
+    }
+    for (size_t i = 2; i < words.size(); i++) {
+      if (words[i] != "easy" && words[i] != "hard") {
+        return Error::format(
+          "$:$: unknown mode $, expected easy or hard",
+          path,
+          line_number,
+          words[i]);
+      }
+      configurations.push_back(Configuration{
+        .allowed_guesses_file = words[0],
+        .possible_secrets_file =
+          words[1] == "-" ? nullopt : make_optional(words[1]),
+        .hard_mode = words[i] == "hard",
+      });
+    }
+  }
+  return configurations;
+}
+
+struct Job {
+  Configuration configuration;
+  GameState game_state;
+  double cost;
+};
+
+OrError<Unit> evaluate_batch(
+  const string& manifest, const EvaluateOptions& options)
+{
+  bail(configurations, parse_manifest(manifest));
+
+  // Every dictionary is interned once, the match table only grows with the
+  // words that weren't seen before
+  map<string, WordList> dictionaries;
+  auto load = [&](const string& filename) -> OrError<WordList> {
+    auto it = dictionaries.find(filename);
+    if (it != dictionaries.end()) { return it->second; }
+    bail(words, Dictionary::load_words(filename));
+    print_line("Loaded $ words from $", words.size(), filename);
+    dictionaries.emplace(filename, words);
+    return words;
+  };
+
+  map<pair<string, bool>, vector<Job>> jobs_by_caches;
+  for (const auto& configuration : configurations) {
+    bail(allowed_guesses, load(configuration.allowed_guesses_file));
+    WordList possible_secrets;
+    if (configuration.possible_secrets_file.has_value()) {
+      bail_assign(possible_secrets, load(*configuration.possible_secrets_file));
+    }
+    GameState game_state(
+      allowed_guesses, possible_secrets, configuration.hard_mode);
+    bail_unit(game_state.validate_words());
+    const double cost = double(game_state.allowed_guesses().size()) *
+                        game_state.possible_secrets().size() *
+                        (configuration.hard_mode ? 1 : easy_mode_cost_factor);
+    auto& jobs = jobs_by_caches[{
+      configuration.allowed_guesses_file, configuration.hard_mode}];
+    jobs.push_back(Job{
+      .configuration = configuration,
+      .game_state = move(game_state),
+      .cost = cost,
+    });
+  }
+
+  // Configurations with the same allowed guesses and mode share the caches,
+  // the most expensive one goes first and fills them with the states the
+  // others reach too. Their results can differ slightly from a run on its own
+  // since the bounds cached by one steer the search of the next. The search
+  // caches are keyed by the secrets only, so easy and hard mode can't share
+  // them. The caches of a group are freed before the next group starts.
+  vector<vector<Job>> groups;
+  for (auto& [key, jobs] : jobs_by_caches) {
+    sort(jobs.begin(), jobs.end(), [](const auto& j1, const auto& j2) {
+      return j1.cost > j2.cost;
+    });
+    groups.push_back(move(jobs));
+  }
+  sort(groups.begin(), groups.end(), [](const auto& g1, const auto& g2) {
+    return g1.front().cost > g2.front().cost;
+  });
+
+  // Configurations run one after another, each with the whole pool. Only the
+  // end of each one leaves threads waiting, and there the last words split
+  // their simulations between the idle threads.
+  vector<string> failed;
+  int idx = 0;
+  for (const auto& jobs : groups) {
+    EvaluateCaches caches(options);
+    for (const auto& job : jobs) {
+      print_line("========================================");
+      print_line(
+        "Configuration $/$: $",
+        ++idx,
+        configurations.size(),
+        job.configuration.name());
+      auto res = evaluate(job.game_state, options, caches);
+      if (res.is_error()) {
+        print_line("Configuration failed: $", res.error());
+        failed.push_back(job.configuration.name());
+      }
+    }
+  }
+
+  if (!failed.empty()) {
+    string names;
+    for (const auto& name : failed) { names += "\n" + name; }
+    return Error::format("$ configurations failed:$", failed.size(), names);
+  }
+  return unit;
+}
+
+} // namespace
+
+Command EvaluateBatch::command()
+{
+  auto builder = CommandBuilder(
+    "Evaluate every configuration of a manifest in a single process");
+  auto manifest = builder.required("--manifest", string_flag);
+  auto options_param = EvaluateOptions::param(builder);
+  return builder.run([=]() -> OrError<Unit> {
+    bail(options, options_param());
+    return evaluate_batch(manifest->value(), options);
+  });
+}
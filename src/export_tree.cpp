@@ -0,0 +1,163 @@
+#include "export_tree.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "engine/binary_format.hpp"
+#include "engine/decision_tree.hpp"
+#include "engine/engine.hpp"
+#include "engine/game_state.hpp"
+#include "engine/simulator.hpp"
+#include "utils/command.hpp"
+#include "utils/error.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+// Same depth sweep as evaluate, keeping the tree of the best strategy
+OrError<unique_ptr<DecisionTree>> best_tree(
+  CachePair& cache_pair,
+  const InternalString first_guess,
+  const GameState& game_state,
+  const WidthPolicy& width_policy,
+  int max_depth)
+{
+  Engine engine(cache_pair, false, width_policy);
+  Simulator simulator(engine);
+  simulator.set_keep_tree(true);
+
+  optional<WordInfo> best_strategy;
+  shared_ptr<const SimNode> best_node;
+  for (int depth = 1; depth <= max_depth; depth++) {
+    bail(info, simulator.simulate(game_state, first_guess, depth));
+    const bool can_stop = info.can_stop;
+    if (!best_strategy.has_value() || is_better_than(info, *best_strategy)) {
+      best_strategy = move(info);
+      best_node = simulator.last_tree();
+    }
+    if (can_stop) break;
+  }
+
+  return DecisionTree::of_sim_node(*best_node);
+}
+
+OrError<Unit> write_file(const string& path, const string& contents)
+{
+  ofstream f(path, ios::out | ios::binary);
+  f.write(contents.data(), contents.size());
+  if (!f.good()) { return Error::format("Failed to write file $", path); }
+  return unit;
+}
+
+OrError<Unit> export_trees(
+  GameState game_state,
+  const WidthPolicy& width_policy,
+  const string& output_dir,
+  const vector<string>& words,
+  int max_words,
+  int max_depth,
+  bool binary)
+{
+  WordList first_guesses;
+  if (words.empty()) {
+    game_state.sort_guesses_by_greedy(false);
+    const auto& allowed = game_state.allowed_guesses();
+    first_guesses.assign(
+      allowed.begin(),
+      allowed.begin() + min<size_t>(max(0, max_words), allowed.size()));
+  } else {
+    // A word that isn't an allowed guess has no row in the match table
+    for (const auto& w : words) {
+      auto it = find_if(
+        game_state.allowed_guesses().begin(),
+        game_state.allowed_guesses().end(),
+        [&](InternalString allowed) { return allowed.str() == w; });
+      if (it == game_state.allowed_guesses().end()) {
+        return Error::format("Unknown word $", w);
+      }
+      first_guesses.push_back(*it);
+    }
+  }
+
+  WordList dictionary = binary_dictionary(game_state.allowed_guesses());
+
+  auto cache_pair = make_unique<CachePair>(1 << 26);
+
+  vector<optional<Error>> errors(first_guesses.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (size_t idx = 0; idx < first_guesses.size(); idx++) {
+    const auto word = first_guesses[idx];
+    auto write_one = [&]() -> OrError<Unit> {
+      bail(
+        tree,
+        best_tree(*cache_pair, word, game_state, width_policy, max_depth));
+      if (binary) {
+        bail(contents, tree->to_binary(dictionary));
+        bail_unit(write_file(format("$/$.bin", output_dir, word), contents));
+      } else {
+        bail_unit(write_file(
+          format("$/$.json", output_dir, word),
+          json::to_json(*tree).to_string()));
+      }
+#pragma omp critical
+      print_line(
+        "Wrote tree for $, worst case $ guesses over $ secrets",
+        word,
+        tree->longest_path,
+        tree->num_secrets);
+      return unit;
+    };
+    auto res = write_one();
+    if (res.is_error()) { errors[idx] = res.error(); }
+  }
+
+  for (size_t idx = 0; idx < first_guesses.size(); idx++) {
+    if (errors[idx].has_value()) {
+      return Error::format(
+        "Failed to write the tree for $: $", first_guesses[idx], *errors[idx]);
+    }
+  }
+  return unit;
+}
+
+} // namespace
+
+Command ExportTree::command()
+{
+  auto builder =
+    CommandBuilder("Write the decision trees of the best first words");
+  auto game_state_param = GameState::param(builder);
+  auto width_policy_param = WidthPolicy::param(builder);
+  auto output_dir = builder.required("--output-dir", string_flag);
+  auto words = builder.optional("--words", string_flag);
+  auto max_words = builder.optional_with_default("--max-words", int_flag, 10);
+  auto max_depth = builder.optional_with_default("--max-depth", int_flag, 15);
+  auto binary = builder.no_arg("--binary");
+  return builder.run([=]() -> OrError<Unit> {
+    bail(game_state, game_state_param());
+    vector<string> word_list;
+    if (words->value().has_value()) {
+      string w;
+      for (char c : *words->value()) {
+        if (c == ',') {
+          if (!w.empty()) { word_list.push_back(move(w)); }
+          w.clear();
+        } else {
+          w += c;
+        }
+      }
+      if (!w.empty()) { word_list.push_back(move(w)); }
+    }
+    return export_trees(
+      move(game_state),
+      width_policy_param(),
+      output_dir->value(),
+      word_list,
+      max_words->value(),
+      max(1, max_depth->value()),
+      binary->value());
+  });
+}
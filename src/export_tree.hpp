@@ -0,0 +1,7 @@
+#pragma once
+
+#include "utils/command.hpp"
+
+struct ExportTree {
+  static Command command();
+};
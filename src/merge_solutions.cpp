@@ -0,0 +1,103 @@
+#include "merge_solutions.hpp"
+
+#include <algorithm>
+
+#include "engine/game_state.hpp"
+#include "engine/simulator.hpp"
+#include "solution_file.hpp"
+#include "utils/command.hpp"
+#include "utils/error.hpp"
+#include "utils/format_optional.hpp"
+#include "utils/format_vector.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+OrError<Unit> merge_solutions(
+  const GameState& game_state,
+  const string& solutions_dir,
+  int num_shards,
+  const optional<int>& solutions_max_words)
+{
+  if (num_shards <= 0) {
+    return Error::format(
+      "Expected a positive number of shards, got $", num_shards);
+  }
+
+  const string state_hash = game_state.hash();
+
+  vector<WordInfo> solutions;
+  vector<string> missing;
+  optional<SolutionManifest> manifest;
+  for (int index = 0; index < num_shards; index++) {
+    const SolutionFile shard_file(
+      solutions_dir, state_hash, Shard{.index = index, .count = num_shards});
+
+    // Every shard has to be done by the same build with the same parameters
+    bail(shard_manifest, shard_file.read_manifest());
+    if (!shard_manifest.has_value() || !shard_manifest->complete) {
+      print_line("Shard $ didn't complete", index);
+      missing.push_back(format("$/$", index, num_shards));
+      continue;
+    }
+    if (!manifest.has_value()) {
+      manifest = shard_manifest;
+    } else if (!manifest->is_current(
+                 shard_manifest->build_id, shard_manifest->parameters)) {
+      return Error::format(
+        "Shard $ was evaluated by another build or with other parameters than "
+        "the first shard",
+        index);
+    }
+
+    auto partial = shard_file.read_partial();
+    if (partial.is_error()) {
+      print_line("Shard $: $", index, partial.error());
+      missing.push_back(format("$/$", index, num_shards));
+      continue;
+    }
+    print_line("Shard $ has $ solutions", index, partial.value().size());
+    for (auto& info : partial.value()) { solutions.push_back(move(info)); }
+  }
+  if (!missing.empty()) {
+    return Error::format("Shards not complete: $", missing);
+  }
+
+  sort(solutions.begin(), solutions.end(), is_better_than);
+  if (
+    solutions_max_words.has_value() &&
+    solutions.size() > size_t(*solutions_max_words)) {
+    solutions.resize(*solutions_max_words);
+  }
+
+  const SolutionFile solution_file(solutions_dir, state_hash);
+  bail_unit(solution_file.write_json(solutions));
+  print_line(
+    "Wrote $ solutions to file $", solutions.size(), solution_file.json_path());
+  manifest->parameters["solutions_max_words"] =
+    format("$", solutions_max_words);
+  return solution_file.write_manifest(*manifest);
+}
+
+} // namespace
+
+Command MergeSolutions::command()
+{
+  auto builder =
+    CommandBuilder("Merge the partial solutions of evaluate's shards");
+  auto game_state_param = GameState::param(builder);
+  auto solutions_dir = builder.required("--write-solutions-dir", string_flag);
+  auto num_shards = builder.required("--shards", int_flag);
+  auto solutions_max_words =
+    builder.optional("--solutions-max-words", int_flag);
+  return builder.run([=]() -> OrError<Unit> {
+    bail(game_state, game_state_param());
+    return merge_solutions(
+      game_state,
+      solutions_dir->value(),
+      num_shards->value(),
+      solutions_max_words->value());
+  });
+}
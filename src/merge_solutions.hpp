@@ -0,0 +1,7 @@
+#pragma once
+
+#include "utils/command.hpp"
+
+struct MergeSolutions {
+  static Command command();
+};
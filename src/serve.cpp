@@ -0,0 +1,506 @@
+#include "serve.hpp"
+
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+#include "engine/engine.hpp"
+#include "engine/game_state.hpp"
+#include "engine/match.hpp"
+#include "engine/search_budget.hpp"
+#include "engine/simulator.hpp"
+#include "solution_file.hpp"
+#include "utils/command.hpp"
+#include "utils/error.hpp"
+#include "utils/json.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+using json::JsonValue;
+
+// Words of the precomputed ranking sent with an answer
+constexpr int ranking_size = 10;
+
+// Entries kept in the maps of solved and precomputed states, half of them
+// are dropped when it is reached like the engine's cache does
+constexpr size_t solved_max_size = 1 << 16;
+constexpr size_t precomputed_max_size = 1 << 10;
+
+// Shared so that dropping them doesn't free them under a request still
+// answering with them
+using Solutions = shared_ptr<const vector<WordInfo>>;
+
+template <class M>
+void drop_half(M& m)
+{
+  size_t counter = 0;
+  for (auto it = m.begin(); it != m.end();) {
+    if ((counter++) % 2 == 0) {
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+struct ServeOptions {
+  WidthPolicy width_policy;
+  int max_depth;
+  int default_time_limit_ms;
+  optional<string> solutions_dir;
+};
+
+// One query, the state is the moves played since the start of the game
+struct Request {
+  optional<JsonValue> id;
+  vector<pair<string, string>> moves;
+  optional<int> time_limit_ms;
+};
+
+OrError<Request> parse_request(const string& line)
+{
+  bail(value, JsonValue::parse(line));
+  const auto* obj = get_if<map<string, JsonValue>>(&value._value);
+  if (obj == nullptr) { return Error("Request is not an object"); }
+
+  Request request;
+  auto id = obj->find("id");
+  if (id != obj->end()) { request.id.emplace(id->second); }
+
+  auto moves = obj->find("moves");
+  if (moves != obj->end()) {
+    const auto* list = get_if<vector<JsonValue>>(&moves->second._value);
+    if (list == nullptr) { return Error("moves is not a list"); }
+    for (const auto& move : *list) {
+      const auto* pair = get_if<vector<JsonValue>>(&move._value);
+      if (pair == nullptr || pair->size() != 2) {
+        return Error("Expected moves to be [guess, pattern] pairs");
+      }
+      const auto* guess = get_if<string>(&(*pair)[0]._value);
+      const auto* pattern = get_if<string>(&(*pair)[1]._value);
+      if (guess == nullptr || pattern == nullptr) {
+        return Error("Expected moves to be [guess, pattern] pairs");
+      }
+      request.moves.emplace_back(*guess, *pattern);
+    }
+  }
+
+  auto time_limit_ms = obj->find("time_limit_ms");
+  if (time_limit_ms != obj->end()) {
+    const auto* ms = get_if<int>(&time_limit_ms->second._value);
+    if (ms == nullptr) { return Error("time_limit_ms is not an integer"); }
+    request.time_limit_ms = *ms;
+  }
+  return request;
+}
+
+// Holds everything that's expensive to build, shared by all the sessions.
+// Searches of different requests run concurrently on the same caches, like
+// the threads of evaluate do.
+struct Server {
+ public:
+  Server(
+    GameState game_state, const ServeOptions& options, int cache_max_size)
+      : _initial_state(move(game_state)),
+        _options(options),
+        _cache_pair(make_unique<CachePair>(cache_max_size))
+  {
+    _initial_state.sort_guesses_by_greedy(false);
+    for (const auto& words :
+         {_initial_state.allowed_guesses(), _initial_state.possible_secrets()}) {
+      for (const auto w : words) { _words.emplace(w.str(), w); }
+    }
+  }
+
+  // Errors are answered too, so that the client can tell which request
+  // failed
+  JsonValue answer(const string& line)
+  {
+    auto request = parse_request(line);
+    if (request.is_error()) {
+      return error_response(nullopt, request.error());
+    }
+    auto response = _answer(request.value());
+    if (response.is_error()) {
+      return error_response(request.value().id, response.error());
+    }
+    return move(response.value());
+  }
+
+ private:
+  static JsonValue error_response(
+    const optional<JsonValue>& id, const Error& error)
+  {
+    map<string, JsonValue> obj{
+      {"id", json::to_json(id)},
+      {"error", json::to_json(error.msg())},
+    };
+    return json::to_json(obj);
+  }
+
+  OrError<JsonValue> _answer(const Request& request)
+  {
+    GameState game_state = _initial_state;
+    for (const auto& [guess_str, pattern] : request.moves) {
+      // Unknown words would get new ids, missing from the match table
+      auto guess = _words.find(guess_str);
+      if (guess == _words.end()) {
+        return Error::format("Unknown word $", guess_str);
+      }
+      bail(match, Match::parse(pattern));
+      bail_unit(game_state.make_guess(guess->second, match));
+    }
+    if (game_state.possible_secrets().empty()) {
+      return Error("No possible secret is left");
+    }
+
+    const string state_hash = game_state.hash();
+    bail(precomputed, find_precomputed(state_hash));
+    if (precomputed != nullptr) {
+      return precomputed_response(request, *precomputed);
+    }
+
+    optional<SearchResult> result;
+    int depth = 0;
+    bool from_cache = false;
+    {
+      lock_guard<mutex> lock(_solved_mutex);
+      auto it = _solved.find(state_hash);
+      if (it != _solved.end()) {
+        result = it->second.first;
+        depth = it->second.second;
+        from_cache = true;
+      }
+    }
+
+    if (!result.has_value()) {
+      Engine engine(*_cache_pair, false, _options.width_policy);
+      engine.set_budget(SearchBudget::with_timeout(chrono::milliseconds(
+        request.time_limit_ms.value_or(_options.default_time_limit_ms))));
+      for (int max_depth = 1; max_depth <= _options.max_depth; max_depth++) {
+        auto res = engine.search(game_state, max_depth);
+        // A depth cut off by the budget has no answer, the last one that
+        // finished is sent instead
+        if (res.is_error()) {
+          if (engine.budget_exhausted() && result.has_value()) break;
+          return res.error();
+        }
+        result = res.value();
+        depth = max_depth;
+        if (result->is_optimal) break;
+      }
+      if (result->is_optimal) {
+        lock_guard<mutex> lock(_solved_mutex);
+        if (_solved.size() >= solved_max_size) { drop_half(_solved); }
+        _solved.emplace(state_hash, make_pair(*result, depth));
+      }
+    }
+
+    map<string, JsonValue> obj{
+      {"id", json::to_json(request.id)},
+      {"guess", json::to_json(result->best_guess)},
+      {"num_guesses", json::to_json(result->num_guesses)},
+      {"is_optimal", json::to_json(result->is_optimal)},
+      {"depth", json::to_json(depth)},
+      {"from_cache", json::to_json(from_cache)},
+    };
+    return json::to_json(obj);
+  }
+
+  // Solutions of the state written by evaluate, nothing when there aren't
+  // any. A file named after the hash of the state only has its words, which
+  // are all interned already.
+  OrError<Solutions> find_precomputed(const string& state_hash)
+  {
+    if (!_options.solutions_dir.has_value()) { return Solutions(); }
+    lock_guard<mutex> lock(_precomputed_mutex);
+    auto it = _precomputed.find(state_hash);
+    if (it == _precomputed.end()) {
+      const SolutionFile solution_file(*_options.solutions_dir, state_hash);
+      bail(solutions, solution_file.read_solutions());
+      if (!solutions.has_value() || solutions->empty()) { return Solutions(); }
+      if (_precomputed.size() >= precomputed_max_size) {
+        drop_half(_precomputed);
+      }
+      it = _precomputed
+             .emplace(
+               state_hash,
+               make_shared<const vector<WordInfo>>(move(*solutions)))
+             .first;
+    }
+    return it->second;
+  }
+
+  static JsonValue precomputed_response(
+    const Request& request, const vector<WordInfo>& solutions)
+  {
+    vector<JsonValue> ranking;
+    for (int i = 0; i < min<int>(ranking_size, solutions.size()); i++) {
+      map<string, JsonValue> entry{
+        {"guess", json::to_json(solutions[i].first_guess)},
+        {"avg_guesses", json::to_json(solutions[i].avg_guesses)},
+        {"worst_num_guesses", json::to_json(solutions[i].worst_num_guesses)},
+      };
+      ranking.push_back(json::to_json(entry));
+    }
+    const auto& best = solutions.front();
+    map<string, JsonValue> obj{
+      {"id", json::to_json(request.id)},
+      {"guess", json::to_json(best.first_guess)},
+      {"num_guesses", json::to_json(best.worst_num_guesses)},
+      {"avg_guesses", json::to_json(best.avg_guesses)},
+      {"from_solutions", json::to_json(true)},
+      {"ranking", json::to_json(ranking)},
+    };
+    return json::to_json(obj);
+  }
+
+  GameState _initial_state;
+  const ServeOptions _options;
+  unique_ptr<CachePair> _cache_pair;
+  unordered_map<string, InternalString> _words;
+
+  // Moves proven optimal and the depth they were found at, answered without
+  // searching
+  mutex _solved_mutex;
+  map<string, pair<SearchResult, int>> _solved;
+
+  // Only the states that have solutions, a miss is just a failed open
+  mutex _precomputed_mutex;
+  map<string, Solutions> _precomputed;
+};
+
+// Requests are answered by a fixed number of threads, in the order they
+// arrived
+struct WorkQueue {
+ public:
+  WorkQueue(int num_threads)
+  {
+    for (int i = 0; i < num_threads; i++) {
+      _threads.emplace_back([this]() { work(); });
+    }
+  }
+
+  // Waits for the queued work to finish
+  ~WorkQueue()
+  {
+    {
+      lock_guard<mutex> lock(_mutex);
+      _closed = true;
+    }
+    _cv.notify_all();
+    for (auto& t : _threads) { t.join(); }
+  }
+
+  void push(function<void()> job)
+  {
+    {
+      lock_guard<mutex> lock(_mutex);
+      _jobs.push_back(move(job));
+    }
+    _cv.notify_one();
+  }
+
+ private:
+  void work()
+  {
+    while (true) {
+      function<void()> job;
+      {
+        unique_lock<mutex> lock(_mutex);
+        _cv.wait(lock, [this]() { return _closed || !_jobs.empty(); });
+        if (_jobs.empty()) return;
+        job = move(_jobs.front());
+        _jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+  mutex _mutex;
+  condition_variable _cv;
+  deque<function<void()>> _jobs;
+  bool _closed = false;
+  vector<thread> _threads;
+};
+
+// A client, answers are written as whole lines so that those of concurrent
+// requests don't interleave. The file descriptor is closed once the client
+// left and its last answer was written.
+struct Connection {
+ public:
+  Connection(int in_fd, int out_fd) : _in_fd(in_fd), _out_fd(out_fd) {}
+
+  ~Connection()
+  {
+    close(_in_fd);
+    if (_out_fd != _in_fd) { close(_out_fd); }
+  }
+
+  // Nothing once the client closed its end
+  optional<string> read_line()
+  {
+    while (true) {
+      auto end = _buffer.find('\n');
+      if (end != string::npos) {
+        string line = _buffer.substr(0, end);
+        _buffer.erase(0, end + 1);
+        return line;
+      }
+      char chunk[4096];
+      ssize_t n = read(_in_fd, chunk, sizeof(chunk));
+      if (n <= 0) {
+        if (_buffer.empty()) return nullopt;
+        return exchange(_buffer, string());
+      }
+      _buffer.append(chunk, n);
+    }
+  }
+
+  // A client that went away (EPIPE, with SIGPIPE ignored) gets nothing
+  // more, the answers still queued for it are dropped
+  void write_line(const string& line)
+  {
+    const string data = line + "\n";
+    lock_guard<mutex> lock(_write_mutex);
+    size_t written = 0;
+    while (!_gone && written < data.size()) {
+      ssize_t n = write(_out_fd, data.data() + written, data.size() - written);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        _gone = true;
+        return;
+      }
+      written += n;
+    }
+  }
+
+ private:
+  const int _in_fd;
+  const int _out_fd;
+  string _buffer;
+  mutex _write_mutex;
+  bool _gone = false;
+};
+
+void serve_connection(
+  shared_ptr<Connection> connection, Server& server, WorkQueue& queue)
+{
+  while (auto line = connection->read_line()) {
+    if (line->empty()) continue;
+    queue.push([connection, &server, line = move(*line)]() {
+      connection->write_line(server.answer(line).to_string());
+    });
+  }
+}
+
+OrError<Unit> serve_socket(
+  const string& socket_path, Server& server, WorkQueue& queue)
+{
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    return Error::format("Socket path $ is too long", socket_path);
+  }
+  socket_path.copy(addr.sun_path, socket_path.size());
+
+  // Only a socket left by a previous server is replaced
+  struct stat existing;
+  if (lstat(socket_path.c_str(), &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      return Error::format("$ exists and is not a socket", socket_path);
+    }
+    unlink(socket_path.c_str());
+  }
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) { return Error("Failed to create socket"); }
+  if (
+    bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+    listen(listen_fd, 64) != 0) {
+    close(listen_fd);
+    return Error::format("Failed to listen on $", socket_path);
+  }
+  print_line("Listening on $", socket_path);
+
+  while (true) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) continue;
+    thread([fd, &server, &queue]() {
+      serve_connection(make_shared<Connection>(fd, fd), server, queue);
+    }).detach();
+  }
+}
+
+} // namespace
+
+Command Serve::command()
+{
+  auto builder = CommandBuilder(
+    "Answer the best guess for game states sent as line delimited JSON, "
+    "keeping the caches warm across games");
+  auto game_state_param = GameState::param(builder);
+  auto width_policy_param = WidthPolicy::param(builder);
+  auto socket_path = builder.optional("--socket", string_flag);
+  auto solutions_dir = builder.optional("--solutions-dir", string_flag);
+  auto num_threads = builder.optional_with_default(
+    "--threads", int_flag, max<int>(1, thread::hardware_concurrency()));
+  auto cache_max_size =
+    builder.optional_with_default("--cache-max-size", int_flag, 1 << 26);
+  auto max_depth = builder.optional_with_default("--max-depth", int_flag, 16);
+  auto default_time_limit_ms =
+    builder.optional_with_default("--time-limit-ms", int_flag, 1000);
+  return builder.run([=]() -> OrError<Unit> {
+    if (max_depth->value() < 1) {
+      return Error::format(
+        "Invalid --max-depth $, expected at least 1", max_depth->value());
+    }
+    // A client closing its end before its answer is written must not take
+    // the server down, write_line sees EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+
+    // Answers go to stdout, everything else to stderr
+    int out_fd = STDOUT_FILENO;
+    if (!socket_path->value().has_value()) {
+      fflush(stdout);
+      out_fd = dup(STDOUT_FILENO);
+      dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
+    bail(game_state, game_state_param());
+    Server server(
+      move(game_state),
+      ServeOptions{
+        .width_policy = width_policy_param(),
+        .max_depth = max_depth->value(),
+        .default_time_limit_ms = default_time_limit_ms->value(),
+        .solutions_dir = solutions_dir->value(),
+      },
+      cache_max_size->value());
+    WorkQueue queue(max(1, num_threads->value()));
+
+    if (socket_path->value().has_value()) {
+      return serve_socket(*socket_path->value(), server, queue);
+    }
+    print_line("Reading requests from stdin");
+    serve_connection(
+      make_shared<Connection>(STDIN_FILENO, out_fd), server, queue);
+    return unit;
+  });
+}
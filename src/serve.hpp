@@ -0,0 +1,7 @@
+#pragma once
+
+#include "utils/command.hpp"
+
+struct Serve {
+  static Command command();
+};
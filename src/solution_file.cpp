@@ -0,0 +1,408 @@
+#include "solution_file.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+using json::JsonValue;
+
+template <class T>
+OrError<const T*> get_field(
+  const map<string, JsonValue>& obj, const string& key)
+{
+  auto it = obj.find(key);
+  if (it == obj.end()) {
+    return Error::format("Record is missing $", key);
+  }
+  const T* value = get_if<T>(&it->second._value);
+  if (value == nullptr) {
+    return Error::format(
+      "Record has an unexpected $: $",
+      key,
+      it->second.what_alternative());
+  }
+  return value;
+}
+
+// Averages are stored as totals over the secrets, so that they read back
+// exactly.
+JsonValue progress_record(const WordInfo& info)
+{
+  int num_secrets = 0;
+  vector<JsonValue> distribution;
+  for (const auto& [num_guesses, count] : info.guess_distribution) {
+    num_secrets += count;
+    const vector<int> entry{num_guesses, count};
+    distribution.push_back(json::to_json(entry));
+  }
+  map<string, JsonValue> obj{
+    {"guess", json::to_json(info.first_guess)},
+    {"total_guesses",
+     json::to_json(int(lround(info.avg_guesses * num_secrets)))},
+    {"worst_num_guesses", json::to_json(info.worst_num_guesses)},
+    {"guess_distribution", json::to_json(distribution)},
+    {"most_difficult_secret", json::to_json(info.most_difficult_secret)},
+    {"max_depth", json::to_json(info.max_depth)},
+    {"all_matches", json::to_json(info.all_matches)},
+    {"can_stop", json::to_json(info.can_stop)},
+  };
+  return json::to_json(obj);
+}
+
+OrError<WordInfo> of_progress_record(const JsonValue& value)
+{
+  const auto* obj = get_if<map<string, JsonValue>>(&value._value);
+  if (obj == nullptr) { return Error("Progress record is not an object"); }
+
+  bail(guess, get_field<string>(*obj, "guess"));
+  bail(total_guesses, get_field<int>(*obj, "total_guesses"));
+  bail(worst_num_guesses, get_field<int>(*obj, "worst_num_guesses"));
+  bail(
+    distribution, get_field<vector<JsonValue>>(*obj, "guess_distribution"));
+  bail(
+    most_difficult_secret, get_field<string>(*obj, "most_difficult_secret"));
+  bail(max_depth, get_field<int>(*obj, "max_depth"));
+  bail(all_matches, get_field<vector<JsonValue>>(*obj, "all_matches"));
+  bail(can_stop, get_field<string>(*obj, "can_stop"));
+
+  WordInfo info;
+  info.first_guess = InternalString(*guess);
+  info.worst_num_guesses = *worst_num_guesses;
+  info.most_difficult_secret = InternalString(*most_difficult_secret);
+  info.max_depth = *max_depth;
+  info.can_stop = *can_stop == "true";
+
+  int num_secrets = 0;
+  for (const auto& d : *distribution) {
+    const auto* pair = get_if<vector<JsonValue>>(&d._value);
+    if (pair == nullptr || pair->size() != 2) {
+      return Error("Progress record has a malformed distribution");
+    }
+    const auto* num_guesses = get_if<int>(&(*pair)[0]._value);
+    const auto* count = get_if<int>(&(*pair)[1]._value);
+    if (num_guesses == nullptr || count == nullptr) {
+      return Error("Progress record has a malformed distribution");
+    }
+    info.guess_distribution[*num_guesses] = *count;
+    num_secrets += *count;
+    info.cumulative_guess_distribution[*num_guesses] = num_secrets;
+  }
+  if (num_secrets == 0) { return Error("Progress record has no secrets"); }
+  info.avg_guesses = double(*total_guesses) / num_secrets;
+
+  for (const auto& m : *all_matches) {
+    const auto* str = get_if<string>(&m._value);
+    if (str == nullptr) {
+      return Error("Progress record pattern is not a string");
+    }
+    bail(match, Match::parse(*str));
+    info.all_matches.push_back(match);
+  }
+  return info;
+}
+
+// The solutions file only has what the web solver shows, the rest of the info
+// is left empty
+OrError<WordInfo> of_solution(const JsonValue& value)
+{
+  const auto* obj = get_if<map<string, JsonValue>>(&value._value);
+  if (obj == nullptr) { return Error("Solution is not an object"); }
+
+  bail(guess, get_field<string>(*obj, "guess"));
+  bail(avg_guesses, get_field<double>(*obj, "avg_guesses"));
+  bail(worst_num_guesses, get_field<int>(*obj, "worst_num_guesses"));
+  bail(max_depth, get_field<int>(*obj, "max_depth"));
+  bail(all_matches, get_field<vector<JsonValue>>(*obj, "all_matches"));
+
+  WordInfo info;
+  info.first_guess = InternalString(*guess);
+  info.avg_guesses = *avg_guesses;
+  info.worst_num_guesses = *worst_num_guesses;
+  info.max_depth = *max_depth;
+  info.can_stop = false;
+  for (const auto& m : *all_matches) {
+    const auto* str = get_if<string>(&m._value);
+    if (str == nullptr) { return Error("Solution pattern is not a string"); }
+    bail(match, Match::parse(*str));
+    info.all_matches.push_back(match);
+  }
+  return info;
+}
+
+OrError<string> read_file(const string& path)
+{
+  ifstream f(path, ios::in | ios::binary);
+  if (!f.is_open()) { return Error::format("Failed to open file $", path); }
+  stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+string to_records(const vector<WordInfo>& infos)
+{
+  string out;
+  for (const auto& info : infos) {
+    out += progress_record(info).to_string() + "\n";
+  }
+  return out;
+}
+
+OrError<WordInfo> of_record_line(const string& line)
+{
+  bail(value, JsonValue::parse(line));
+  return of_progress_record(value);
+}
+
+// Also returns where the complete lines end, a last line without its newline
+// was cut off while being written. Any complete line that doesn't parse fails
+// with the path and line number of the file.
+OrError<pair<vector<WordInfo>, size_t>> of_records(
+  const string& path, const string& contents)
+{
+  vector<WordInfo> out;
+  size_t start = 0;
+  int line_number = 0;
+  for (size_t end = contents.find('\n'); end != string::npos;
+       end = contents.find('\n', start)) {
+    line_number++;
+    if (end > start) {
+      auto info = of_record_line(contents.substr(start, end - start));
+      if (info.is_error()) {
+        return Error::format("$:$: $", path, line_number, info.error());
+      }
+      out.push_back(move(info.value()));
+    }
+    start = end + 1;
+  }
+  return make_pair(move(out), start);
+}
+
+} // namespace
+
+OrError<Shard> Shard::parse(const string& str)
+{
+  Shard shard;
+  char slash;
+  istringstream ss(str);
+  if (
+    !(ss >> shard.index >> slash >> shard.count) || slash != '/' ||
+    !ss.eof() || shard.count <= 0 || shard.index < 0 ||
+    shard.index >= shard.count) {
+    return Error::format("Invalid shard $, expected i/n with 0 <= i < n", str);
+  }
+  return shard;
+}
+
+bool SolutionManifest::is_same_run(
+  const string& current_build_id,
+  const map<string, string>& current_parameters) const
+{
+  return build_id == current_build_id && parameters == current_parameters;
+}
+
+bool SolutionManifest::is_current(
+  const string& current_build_id,
+  const map<string, string>& current_parameters) const
+{
+  return complete && is_same_run(current_build_id, current_parameters);
+}
+
+JsonValue SolutionManifest::to_json() const
+{
+  map<string, JsonValue> obj{
+    {"build_id", json::to_json(build_id)},
+    {"parameters", json::to_json(parameters)},
+    {"complete", json::to_json(complete)},
+  };
+  return json::to_json(obj);
+}
+
+OrError<SolutionManifest> SolutionManifest::of_json(const JsonValue& value)
+{
+  const auto* obj = get_if<map<string, JsonValue>>(&value._value);
+  if (obj == nullptr) { return Error("Manifest is not an object"); }
+  bail(build_id, get_field<string>(*obj, "build_id"));
+  using JsonObject = map<string, JsonValue>;
+  bail(parameters, get_field<JsonObject>(*obj, "parameters"));
+  bail(complete, get_field<string>(*obj, "complete"));
+
+  SolutionManifest manifest;
+  manifest.build_id = *build_id;
+  manifest.complete = *complete == "true";
+  for (const auto& [key, v] : *parameters) {
+    const auto* str = get_if<string>(&v._value);
+    if (str == nullptr) {
+      return Error::format("Manifest parameter $ is not a string", key);
+    }
+    manifest.parameters[key] = *str;
+  }
+  return manifest;
+}
+
+OrError<Unit> write_file_atomically(const string& path, const string& contents)
+{
+  const string tmp_path = path + ".tmp";
+  {
+    ofstream f(tmp_path, ios::out | ios::binary | ios::trunc);
+    f.write(contents.data(), contents.size());
+    f.close();
+    if (!f.good()) {
+      return Error::format("Failed to write file $", tmp_path);
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    return Error::format("Failed to rename $ to $", tmp_path, path);
+  }
+  return unit;
+}
+
+SolutionFile::SolutionFile(
+  const string& dir, const string& state_hash, const optional<Shard>& shard)
+    : _dir(dir),
+      _name(
+        shard.has_value()
+          ? format("$.shard-$-of-$", state_hash, shard->index, shard->count)
+          : state_hash)
+{}
+
+string SolutionFile::json_path() const
+{
+  return format("$/$.json", _dir, _name);
+}
+
+string SolutionFile::binary_path() const
+{
+  return format("$/$.bin", _dir, _name);
+}
+
+string SolutionFile::opening_book_path() const
+{
+  return format("$/$.book.json", _dir, _name);
+}
+
+string SolutionFile::progress_path() const
+{
+  return format("$/$.progress", _dir, _name);
+}
+
+string SolutionFile::partial_path() const
+{
+  return format("$/$.partial", _dir, _name);
+}
+
+string SolutionFile::manifest_path() const
+{
+  return format("$/$.manifest.json", _dir, _name);
+}
+
+OrError<Unit> SolutionFile::write_json(const vector<WordInfo>& solutions) const
+{
+  return write_file_atomically(
+    json_path(), json::to_json(solutions).to_string());
+}
+
+OrError<Unit> SolutionFile::write_binary(const string& contents) const
+{
+  return write_file_atomically(binary_path(), contents);
+}
+
+OrError<Unit> SolutionFile::write_opening_book(const string& contents) const
+{
+  return write_file_atomically(opening_book_path(), contents);
+}
+
+OrError<Unit> SolutionFile::append_progress(const WordInfo& info) const
+{
+  const string line = to_records({info});
+  ofstream f(progress_path(), ios::out | ios::binary | ios::app);
+  f.write(line.data(), line.size());
+  f.close();
+  if (!f.good()) {
+    return Error::format("Failed to append to $", progress_path());
+  }
+  return unit;
+}
+
+OrError<vector<WordInfo>> SolutionFile::read_progress() const
+{
+  if (!ifstream(progress_path()).is_open()) { return vector<WordInfo>(); }
+  bail(contents, read_file(progress_path()));
+  bail(records, of_records(progress_path(), contents));
+  auto& [out, end] = records;
+  if (end != contents.size()) {
+    // Drops the cut off line so that the next record starts on its own line
+    bail_unit(write_file_atomically(progress_path(), contents.substr(0, end)));
+  }
+  return move(out);
+}
+
+OrError<Unit> SolutionFile::clear_progress() const
+{
+  if (remove(progress_path().c_str()) != 0 && errno != ENOENT) {
+    return Error::format("Failed to remove $", progress_path());
+  }
+  return unit;
+}
+
+OrError<Unit> SolutionFile::write_partial(
+  const vector<WordInfo>& solutions) const
+{
+  return write_file_atomically(partial_path(), to_records(solutions));
+}
+
+OrError<vector<WordInfo>> SolutionFile::read_partial() const
+{
+  bail(contents, read_file(partial_path()));
+  bail(records, of_records(partial_path(), contents));
+  if (records.second != contents.size()) {
+    return Error::format("$ ends with a partial line", partial_path());
+  }
+  return move(records.first);
+}
+
+OrError<Unit> SolutionFile::write_manifest(
+  const SolutionManifest& manifest) const
+{
+  return write_file_atomically(
+    manifest_path(), manifest.to_json().to_string());
+}
+
+OrError<optional<SolutionManifest>> SolutionFile::read_manifest() const
+{
+  if (!ifstream(manifest_path()).is_open()) {
+    return optional<SolutionManifest>();
+  }
+  bail(contents, read_file(manifest_path()));
+  bail(value, JsonValue::parse(contents));
+  bail(manifest, SolutionManifest::of_json(value));
+  return make_optional(move(manifest));
+}
+
+OrError<optional<vector<WordInfo>>> SolutionFile::read_solutions() const
+{
+  using Solutions = optional<vector<WordInfo>>;
+  if (!ifstream(json_path()).is_open()) { return Solutions(); }
+  bail(manifest, read_manifest());
+  if (manifest.has_value() && !manifest->complete) { return Solutions(); }
+
+  bail(contents, read_file(json_path()));
+  bail(value, JsonValue::parse(contents));
+  const auto* list = get_if<vector<JsonValue>>(&value._value);
+  if (list == nullptr) {
+    return Error::format("Solutions in $ are not a list", json_path());
+  }
+  vector<WordInfo> solutions;
+  for (const auto& v : *list) {
+    bail(info, of_solution(v));
+    solutions.push_back(move(info));
+  }
+  return make_optional(move(solutions));
+}
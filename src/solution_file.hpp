@@ -0,0 +1,107 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "engine/simulator.hpp"
+#include "utils/error.hpp"
+#include "utils/json.hpp"
+
+// One of the count parts of the first guesses, each run by its own evaluate
+// and merged afterwards. Written i/n on the command line, from 0.
+struct Shard {
+  int index;
+  int count;
+
+  bool contains(int word_idx) const { return word_idx % count == index; }
+
+  static OrError<Shard> parse(const std::string& str);
+};
+
+// Written next to the solutions, what produced them and whether the run that
+// did finished
+struct SolutionManifest {
+  std::string build_id;
+  // Only the ones that change the solutions
+  std::map<std::string, std::string> parameters;
+  bool complete = false;
+
+  // Whether it was written by a run with these, complete or not
+  bool is_same_run(
+    const std::string& build_id,
+    const std::map<std::string, std::string>& parameters) const;
+
+  // Whether the solutions would be the same as a run with these
+  bool is_current(
+    const std::string& build_id,
+    const std::map<std::string, std::string>& parameters) const;
+
+  json::JsonValue to_json() const;
+
+  static OrError<SolutionManifest> of_json(const json::JsonValue& value);
+};
+
+// The files evaluate writes into the solutions directory for a game state,
+// all named after its hash.
+//
+// Besides the solutions, a run appends each first guess it's done with to a
+// progress log, one JSON object per line, so that an interrupted run can
+// resume. A line only counts once its newline made it to the file.
+//
+// The files of a shard are named after the shard too. Instead of the
+// solutions, a shard writes its best words in the format of the progress log
+// once it's complete, merge-solutions reads them back.
+struct SolutionFile {
+ public:
+  SolutionFile(
+    const std::string& dir,
+    const std::string& state_hash,
+    const std::optional<Shard>& shard = std::nullopt);
+
+  std::string json_path() const;
+  std::string binary_path() const;
+  std::string opening_book_path() const;
+  std::string progress_path() const;
+  std::string partial_path() const;
+  std::string manifest_path() const;
+
+  // The solutions as loaded by the web solver
+  OrError<Unit> write_json(const std::vector<WordInfo>& solutions) const;
+
+  OrError<Unit> write_binary(const std::string& contents) const;
+
+  OrError<Unit> write_opening_book(const std::string& contents) const;
+
+  // The solutions of a run that finished, best first. Nothing when there are
+  // none or the run that writes them is still going. Solutions without a
+  // manifest predate manifests and are taken as finished.
+  OrError<std::optional<std::vector<WordInfo>>> read_solutions() const;
+
+  OrError<Unit> append_progress(const WordInfo& info) const;
+
+  // Words of the game state that were done, in the order they finished.
+  // Drops a line that was cut off from the log.
+  OrError<std::vector<WordInfo>> read_progress() const;
+
+  OrError<Unit> clear_progress() const;
+
+  OrError<Unit> write_partial(const std::vector<WordInfo>& solutions) const;
+
+  OrError<std::vector<WordInfo>> read_partial() const;
+
+  OrError<Unit> write_manifest(const SolutionManifest& manifest) const;
+
+  // Nothing when there's no manifest yet
+  OrError<std::optional<SolutionManifest>> read_manifest() const;
+
+ private:
+  std::string _dir;
+  std::string _name;
+};
+
+// Writes to a temporary file renamed over the path, so readers never see a
+// partially written file.
+OrError<Unit> write_file_atomically(
+  const std::string& path, const std::string& contents);
@@ -1,13 +1,26 @@
 #include "suggest.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <omp.h>
+#include <thread>
 
 #include "engine/engine.hpp"
 #include "engine/game_state.hpp"
+#include "engine/greedy.hpp"
 #include "engine/match.hpp"
+#include "engine/search_budget.hpp"
+#include "engine/simulation_cache.hpp"
 #include "engine/simulator.hpp"
+#include "solution_file.hpp"
 #include "utils/command.hpp"
 #include "utils/error.hpp"
 #include "utils/format_optional.hpp"
@@ -17,55 +30,152 @@ using namespace fmt;
 
 namespace {
 
-bool sig_int_received = false;
+CancellationToken sig_int_token;
 
-void handle_sig_int(int) { sig_int_received = true; }
+void handle_sig_int(int) { sig_int_token.cancel(); }
 
-OrError<Unit> suggest_guess(
-  GameState game_state,
-  const optional<string>& guesses_filename,
-  int max_depth,
-  int initial_depth)
-{
-  auto cache_pair = make_unique<CachePair>(1 << 26);
+constexpr auto progress_period = chrono::milliseconds(100);
+constexpr int progress_num_words = 32;
 
-  signal(SIGINT, handle_sig_int);
+// Best result so far of each first guess. A slot is only written by the
+// thread searching its word, so updates take no lock, and the top words are
+// only sorted out when the progress is shown.
+struct Scoreboard {
+ public:
+  struct Entry {
+    InternalString word;
+    double avg_guesses;
+    int worst_num_guesses;
+  };
 
-  int num_done = 0;
-
-  int go_back_lines = 0;
-  auto show_progress = [&](
-                         const map<InternalString, WordInfo>& suggestions,
-                         InternalString first_guess,
-                         int depth) {
-    vector<WordInfo> words;
-    for (auto& info : suggestions) { words.push_back(info.second); }
-
-    stable_sort(
-      words.begin(), words.end(), [](const auto& el1, const auto& el2) {
-        if (el1.avg_guesses != el2.avg_guesses) {
-          return el1.avg_guesses < el2.avg_guesses;
-        } else {
-          return el1.first_guess.str() < el2.first_guess.str();
-        }
+  Scoreboard(const WordList& words) : _words(words), _slots(words.size()) {}
+
+  void update(int word_idx, const WordInfo& info, int depth)
+  {
+    auto& slot = _slots[word_idx];
+    slot.worst_num_guesses.store(
+      info.worst_num_guesses, memory_order_relaxed);
+    slot.avg_guesses.store(info.avg_guesses, memory_order_relaxed);
+    _last_updated.store(word_idx, memory_order_relaxed);
+    _last_depth.store(depth, memory_order_relaxed);
+    _version.fetch_add(1, memory_order_release);
+  }
+
+  void word_done()
+  {
+    _num_done.fetch_add(1, memory_order_relaxed);
+    _version.fetch_add(1, memory_order_release);
+  }
+
+  // Changes whenever something was updated
+  int version() const { return _version.load(memory_order_acquire); }
+
+  // The k best words that have a result, best first
+  vector<Entry> top(int k) const
+  {
+    vector<Entry> entries;
+    for (size_t i = 0; i < _slots.size(); i++) {
+      const double avg_guesses =
+        _slots[i].avg_guesses.load(memory_order_relaxed);
+      if (avg_guesses == numeric_limits<double>::infinity()) continue;
+      entries.push_back(Entry{
+        .word = _words[i],
+        .avg_guesses = avg_guesses,
+        .worst_num_guesses =
+          _slots[i].worst_num_guesses.load(memory_order_relaxed),
       });
+    }
+    const auto better = [](const Entry& e1, const Entry& e2) {
+      if (e1.avg_guesses != e2.avg_guesses) {
+        return e1.avg_guesses < e2.avg_guesses;
+      } else {
+        return e1.word.str() < e2.word.str();
+      }
+    };
+    const int n = min<int>(k, entries.size());
+    partial_sort(entries.begin(), entries.begin() + n, entries.end(), better);
+    entries.resize(n);
+    return entries;
+  }
+
+  int num_done() const { return _num_done.load(memory_order_relaxed); }
+  int num_words() const { return _words.size(); }
+  InternalString last_updated() const
+  {
+    return _words[_last_updated.load(memory_order_relaxed)];
+  }
+  int last_depth() const { return _last_depth.load(memory_order_relaxed); }
+
+ private:
+  struct Slot {
+    atomic<double> avg_guesses{numeric_limits<double>::infinity()};
+    atomic<int> worst_num_guesses{0};
+  };
 
+  const WordList& _words;
+  vector<Slot> _slots;
+  atomic<int> _last_updated{0};
+  atomic<int> _last_depth{0};
+  atomic<int> _num_done{0};
+  atomic<int> _version{0};
+};
+
+// Redraws the top words of a scoreboard at a fixed rate from its own thread,
+// the search threads never wait on the terminal
+struct ProgressDisplay {
+ public:
+  ProgressDisplay(const Scoreboard& scoreboard)
+      : _scoreboard(scoreboard), _thread([this]() { run(); })
+  {}
+
+  // Shows the final state before returning
+  ~ProgressDisplay()
+  {
+    {
+      lock_guard<mutex> lock(_mutex);
+      _stopped = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+  }
+
+ private:
+  void run()
+  {
+    int shown_version = 0;
+    unique_lock<mutex> lock(_mutex);
+    while (true) {
+      const bool stopped = _cv.wait_for(
+        lock, progress_period, [this]() { return _stopped; });
+      const int version = _scoreboard.version();
+      if (version != shown_version) {
+        shown_version = version;
+        show();
+      }
+      if (stopped) break;
+    }
+  }
+
+  void show()
+  {
     vector<string> lines;
 
     lines.push_back(format(
       "\x1b[?25l\x1b[$A",
-      go_back_lines)); // move cursor up and hide cursor
-    lines.push_back(format("Updated $ depth:$", first_guess, depth));
+      _go_back_lines)); // move cursor up and hide cursor
+    lines.push_back(format(
+      "Updated $ depth:$",
+      _scoreboard.last_updated(),
+      _scoreboard.last_depth()));
     lines.push_back(
-      format("Done $/$", num_done, game_state.allowed_guesses().size()));
+      format("Done $/$", _scoreboard.num_done(), _scoreboard.num_words()));
     lines.push_back("Top words so far:");
-    for (int i = 0; i < min<int>(32, words.size()); i++) {
-      auto& info = words[i];
+    for (const auto& entry : _scoreboard.top(progress_num_words)) {
       lines.push_back(format(
         "Word:$ Worst case num guesses: $, avg guesses: $",
-        info.first_guess,
-        info.worst_num_guesses,
-        info.avg_guesses));
+        entry.word,
+        entry.worst_num_guesses,
+        entry.avg_guesses));
     }
     lines.push_back("----------------------------------------\x1b[?25h");
 
@@ -75,54 +185,178 @@ OrError<Unit> suggest_guess(
       output += '\n';
     }
     cout << output << flush;
-    go_back_lines = lines.size();
+    _go_back_lines = lines.size();
+  }
+
+  const Scoreboard& _scoreboard;
+  int _go_back_lines = 0;
+
+  mutex _mutex;
+  condition_variable _cv;
+  bool _stopped = false;
+
+  thread _thread;
+};
+
+OrError<Unit> suggest_guess(
+  GameState game_state,
+  const WidthPolicy& width_policy,
+  const optional<string>& guesses_filename,
+  int max_depth,
+  int initial_depth,
+  const optional<int>& time_limit_ms,
+  const optional<int>& multipv,
+  const optional<string>& solutions_dir)
+{
+  auto cache_pair = make_unique<CachePair>(1 << 26);
+  auto simulation_cache = make_unique<SimulationCache>(1 << 20);
+
+  signal(SIGINT, handle_sig_int);
+
+  auto print_done = [&](const SearchBudget& budget) {
+    SearchBudget final_budget = budget;
+    if (sig_int_token.is_cancelled()) {
+      print_line("Thinking interruped");
+    } else if (final_budget.check()) {
+      print_line("Time limit reached, showing the best found so far");
+    } else {
+      print_line("Done thinking");
+    }
+  };
+
+  auto make_budget = [&]() {
+    sig_int_token.reset();
+    return time_limit_ms.has_value()
+             ? SearchBudget::with_timeout(
+                 chrono::milliseconds(*time_limit_ms), sig_int_token)
+             : SearchBudget(nullopt, sig_int_token);
+  };
+
+  auto suggest_multipv = [&](int n) -> OrError<Unit> {
+    const SearchBudget budget = make_budget();
+    Engine engine(*cache_pair, false, width_policy);
+    engine.set_budget(budget);
+    for (int depth = initial_depth; depth <= max_depth; depth++) {
+      auto entries_or_error = engine.search_multipv(game_state, depth, n);
+      if (entries_or_error.is_error()) {
+        if (!engine.budget_exhausted()) {
+          print_line("Search failed: $", entries_or_error.error());
+        }
+        break;
+      }
+      const auto& entries = entries_or_error.value();
+      print_line("Top words at depth:$", depth);
+      bool all_optimal = true;
+      for (const auto& entry : entries) {
+        print_line(
+          "Word:$ Worst case num guesses: $",
+          entry.guess,
+          string(entry.is_exact ? "" : ">=") + format("$", entry.num_guesses) +
+            (entry.is_optimal ? "" : " (not proven)"));
+        all_optimal = all_optimal && entry.is_optimal;
+      }
+      print_line("----------------------------------------");
+      if (all_optimal) break;
+    }
+    print_done(budget);
+    return unit;
+  };
+
+  // States evaluate already solved, like the start of the game, are answered
+  // from its solutions
+  auto suggest_precomputed = [&]() -> OrError<bool> {
+    if (!solutions_dir.has_value()) { return false; }
+    const SolutionFile solution_file(*solutions_dir, game_state.hash());
+    bail(solutions, solution_file.read_solutions());
+    if (!solutions.has_value() || solutions->empty()) { return false; }
+    print_line("Top words from $:", solution_file.json_path());
+    const int num_words = min<int>(multipv.value_or(32), solutions->size());
+    for (int i = 0; i < num_words; i++) {
+      const auto& info = (*solutions)[i];
+      print_line(
+        "Word:$ Worst case num guesses: $, avg guesses: $",
+        info.first_guess,
+        info.worst_num_guesses,
+        info.avg_guesses);
+    }
+    print_line("----------------------------------------");
+    return true;
   };
 
   auto suggest = [&]() -> OrError<Unit> {
     if (game_state.possible_secrets().empty()) { return Error("No solution"); }
 
+    bail(precomputed, suggest_precomputed());
+    if (precomputed) { return unit; }
+
+    if (multipv.has_value()) { return suggest_multipv(max(1, *multipv)); }
+
     game_state.sort_guesses_by_greedy(false);
 
-    map<InternalString, WordInfo> suggestions;
+    const SearchBudget budget = make_budget();
+
+    // With fewer words than threads, like late in a hard mode game, the
+    // threads are better used within each simulation
+    const bool parallel_words =
+      game_state.allowed_guesses().size() >= size_t(omp_get_max_threads());
+
+    // Without a time limit every word runs to the end, starting with the most
+    // expensive ones keeps the threads busy until the last word. With one the
+    // best words are better found early.
+    WordList first_guesses = game_state.allowed_guesses();
+    if (!time_limit_ms.has_value()) {
+      vector<int64_t> costs(first_guesses.size());
+      for (size_t i = 0; i < first_guesses.size(); i++) {
+        costs[i] = predicted_simulation_cost(
+          first_guesses[i], game_state.possible_secrets());
+      }
+      vector<int> order(first_guesses.size());
+      iota(order.begin(), order.end(), 0);
+      stable_sort(order.begin(), order.end(), [&](int i1, int i2) {
+        return costs[i1] > costs[i2];
+      });
+      for (size_t i = 0; i < order.size(); i++) {
+        first_guesses[i] = game_state.allowed_guesses()[order[i]];
+      }
+    }
 
-    sig_int_received = false;
+    Scoreboard scoreboard(first_guesses);
+    optional<ProgressDisplay> display;
+    display.emplace(scoreboard);
 
-#pragma omp parallel for schedule(dynamic, 1)
-    for (InternalString first_guess : game_state.allowed_guesses()) {
-      if (sig_int_received) continue;
+#pragma omp parallel for schedule(dynamic, 1) if (parallel_words)
+    for (size_t word_idx = 0; word_idx < first_guesses.size(); word_idx++) {
+      const InternalString first_guess = first_guesses[word_idx];
+      SearchBudget word_budget = budget;
+      if (word_budget.check()) continue;
       optional<WordInfo> best_sol;
-      Engine engine(*cache_pair, false);
+      Engine engine(*cache_pair, false, width_policy);
+      engine.set_budget(budget);
+      Simulator sim(engine);
+      sim.set_parallel(!parallel_words);
+      sim.set_simulation_cache(*simulation_cache);
       for (int depth = initial_depth; depth <= max_depth; depth++) {
-        if (sig_int_received) break;
-        Simulator sim(engine);
+        if (word_budget.check()) break;
         auto info_or_error = sim.simulate(game_state, first_guess, depth);
         if (info_or_error.is_error()) {
-          print_line("Search failed: $", info_or_error.error());
+          if (!engine.budget_exhausted()) {
+            print_line("Search failed: $", info_or_error.error());
+          }
           break;
         }
         auto& info = info_or_error.value();
 
         if (!best_sol.has_value() || info.avg_guesses < best_sol->avg_guesses) {
           best_sol = info;
-#pragma omp critical
-          {
-            suggestions[first_guess] = info;
-            show_progress(suggestions, first_guess, depth);
-          }
+          scoreboard.update(word_idx, info, depth);
         }
         if (info.can_stop) break;
       }
-#pragma omp critical
-      {
-        num_done++;
-      }
+      scoreboard.word_done();
     }
 
-    if (sig_int_received) {
-      print_line("Thinking interruped");
-    } else {
-      print_line("Done thinking");
-    }
+    display.reset();
+    print_done(budget);
 
     return unit;
   };
@@ -200,16 +434,24 @@ Command Suggest::command()
 {
   auto builder = CommandBuilder("Suggest a good guess");
   auto game_state_param = GameState::param(builder);
+  auto width_policy_param = WidthPolicy::param(builder);
   auto guesses_file = builder.optional("--guesses-file", string_flag);
   auto max_depth = builder.optional_with_default("--max-depth", int_flag, 16);
   auto initial_depth =
     builder.optional_with_default("--initial-depth", int_flag, 1);
+  auto time_limit_ms = builder.optional("--time-limit-ms", int_flag);
+  auto multipv = builder.optional("--multipv", int_flag);
+  auto solutions_dir = builder.optional("--solutions-dir", string_flag);
   return builder.run([=]() -> OrError<Unit> {
     bail(game_state, game_state_param());
     return suggest_guess(
       move(game_state),
+      width_policy_param(),
       guesses_file->value(),
       max_depth->value(),
-      initial_depth->value());
+      initial_depth->value(),
+      time_limit_ms->value(),
+      multipv->value(),
+      solutions_dir->value());
   });
 }
@@ -1,7 +1,9 @@
 #include "json.hpp"
 
 #include <cassert>
+#include <stdexcept>
 
+#include "utils/error.hpp"
 #include "utils/format.hpp"
 
 using namespace std;
@@ -28,14 +30,7 @@ struct Reader {
     return _str[_pos];
   }
 
-  string next_chars(size_t count) const
-  {
-    if (_str.size() < count + _pos) {
-      return _str.substr(_pos);
-    } else {
-      return _str.substr(_pos, _pos + count);
-    }
-  }
+  string next_chars(size_t count) const { return _str.substr(_pos, count); }
 
   bool eof() const { return _pos >= _str.size(); }
 
@@ -46,13 +41,43 @@ struct Reader {
   size_t _pos = 0;
 };
 
-JsonValue parse_number(Reader& reader)
+void skip_whitespace(Reader& reader)
+{
+  while (!reader.eof() && isspace(reader.peek())) { reader.pop(); }
+}
+
+Error unexpected(Reader& reader, const char* what)
+{
+  if (reader.eof()) { return Error::format("Unexpected end of json, $", what); }
+  return Error::format("$, next chars: '$'", what, reader.next_chars(20));
+}
+
+// Numbers with a fraction or an exponent are doubles, the rest ints
+OrError<JsonValue> parse_number(Reader& reader)
 {
-  int number = 0;
-  while (!reader.eof() && isdigit(reader.peek())) {
-    number = number * 10 + (reader.pop() - '0');
+  string number;
+  bool is_double = false;
+  while (!reader.eof()) {
+    char c = reader.peek();
+    if (c == '.' || c == 'e' || c == 'E') {
+      is_double = true;
+    } else if (!isdigit(c) && c != '-' && c != '+') {
+      break;
+    }
+    number += reader.pop();
+  }
+  size_t end = 0;
+  try {
+    if (is_double) {
+      const double value = stod(number, &end);
+      if (end == number.size()) { return JsonValue(value); }
+    } else {
+      const int value = stoi(number, &end);
+      if (end == number.size()) { return JsonValue(value); }
+    }
+  } catch (const logic_error&) {
   }
-  return JsonValue(number);
+  return Error::format("Invalid number $", number);
 }
 
 JsonValue parse_keyword(Reader& reader)
@@ -62,18 +87,15 @@ JsonValue parse_keyword(Reader& reader)
   return JsonValue(move(word));
 }
 
-string parse_string(Reader& reader)
+OrError<string> parse_string(Reader& reader)
 {
-  string str;
-  if (reader.peek() != '"') {
-    print_line(
-      "Got unexpected char at beginning of string, next chars: '$'",
-      reader.next_chars(20));
-    assert(false && "Unexpected char at beginning of string");
+  if (reader.eof() || reader.peek() != '"') {
+    return unexpected(reader, "expected a string");
   }
   reader.pop();
+  string str;
   while (true) {
-    assert(!reader.eof() && "Unexpected end of string");
+    if (reader.eof()) { return unexpected(reader, "unterminated string"); }
     char c = reader.pop();
     if (c == '"') { break; }
 
@@ -82,80 +104,70 @@ string parse_string(Reader& reader)
   return str;
 }
 
-optional<JsonValue> parse_any_json(Reader& reader);
+OrError<JsonValue> parse_any_json(Reader& reader);
 
-JsonValue parse_list(Reader& reader)
+OrError<JsonValue> parse_list(Reader& reader)
 {
   vector<JsonValue> values;
-  assert(reader.pop() == '[');
+  reader.pop();
+  skip_whitespace(reader);
+  if (!reader.eof() && reader.peek() == ']') {
+    reader.pop();
+    return JsonValue(move(values));
+  }
   while (true) {
-    assert(!reader.eof() && "Unexpected end of list");
+    bail(element, parse_any_json(reader));
+    values.push_back(move(element));
 
-    if (reader.peek() == ']') {
-      reader.pop();
-      break;
-    }
-
-    auto element = parse_any_json(reader);
-    assert(element.has_value() && "Invalid json list element");
-
-    values.push_back(move(*element));
-
-    assert(!reader.eof() && "Unexpected end of list");
+    skip_whitespace(reader);
+    if (reader.eof()) { return unexpected(reader, "unterminated list"); }
     char c = reader.pop();
     if (c == ']') {
       break;
-    } else if (c == ',') {
-      // continue
-    } else {
-      assert("Unexpected character inside list");
+    } else if (c != ',') {
+      return unexpected(reader, "expected , or ] in list");
     }
   }
   return JsonValue(move(values));
 }
 
-JsonValue parse_object(Reader& reader)
+OrError<JsonValue> parse_object(Reader& reader)
 {
   map<string, JsonValue> values;
-  assert(reader.pop() == '{');
+  reader.pop();
+  skip_whitespace(reader);
+  if (!reader.eof() && reader.peek() == '}') {
+    reader.pop();
+    return JsonValue(move(values));
+  }
   while (true) {
-    assert(!reader.eof() && "Unexpected end of object");
+    skip_whitespace(reader);
+    bail(key, parse_string(reader));
 
-    if (reader.peek() == '}') {
-      reader.pop();
-      break;
+    skip_whitespace(reader);
+    if (reader.eof() || reader.pop() != ':') {
+      return unexpected(reader, "expected : after object key");
     }
 
-    auto key = parse_string(reader);
+    bail(value, parse_any_json(reader));
+    values.emplace(move(key), move(value));
 
-    {
-      assert(!reader.eof() && "Unexpected end of object");
-      char c = reader.pop();
-      assert(c == ':' && "Expectd colon after object key");
-    }
-
-    auto value = parse_any_json(reader);
-    assert(value.has_value() && "Invalid json object value");
-    values.emplace(move(key), move(*value));
-
-    assert(!reader.eof() && "Unexpected end of object");
-    {
-      char c = reader.pop();
-      if (c == '}') {
-        break;
-      } else if (c == ',') {
-        // continue
-      } else {
-        assert("Unexpected character inside object");
-      }
+    skip_whitespace(reader);
+    if (reader.eof()) { return unexpected(reader, "unterminated object"); }
+    char c = reader.pop();
+    if (c == '}') {
+      break;
+    } else if (c != ',') {
+      return unexpected(reader, "expected , or } in object");
     }
   }
   return JsonValue(move(values));
 }
 
-optional<JsonValue> parse_any_json(Reader& reader)
+OrError<JsonValue> parse_any_json(Reader& reader)
 {
-  if (reader.eof()) { return nullopt; }
+  skip_whitespace(reader);
+  if (reader.eof()) { return unexpected(reader, "expected a value"); }
 
   char c = reader.peek();
   if (c == '{') {
@@ -163,13 +175,14 @@ optional<JsonValue> parse_any_json(Reader& reader)
   } else if (c == '[') {
     return parse_list(reader);
   } else if (c == '"') {
-    return JsonValue(parse_string(reader));
-  } else if (isdigit(c)) {
+    bail(str, parse_string(reader));
+    return JsonValue(move(str));
+  } else if (isdigit(c) || c == '-') {
     return parse_number(reader);
   } else if (isalpha(c)) {
     return parse_keyword(reader);
   } else {
-    assert(false && "Unexpected charater");
+    return unexpected(reader, "unexpected character");
   }
 }
 
@@ -216,11 +229,24 @@ std::string JsonValue::to_string() const
 }
 
 JsonValue JsonValue::of_string(const string& str)
+{
+  auto value = parse(str);
+  if (value.is_error()) {
+    print_line("Failed to parse json: $", value.error());
+    assert(false && "Invalid json");
+  }
+  return move(value.value());
+}
+
+OrError<JsonValue> JsonValue::parse(const string& str)
 {
   Reader reader(str);
-  auto value = parse_any_json(reader);
-  assert(value.has_value() && "empty json");
-  return move(*value);
+  bail(value, parse_any_json(reader));
+  skip_whitespace(reader);
+  if (!reader.eof()) {
+    return unexpected(reader, "expected the end of the json");
+  }
+  return value;
 }
 
 string JsonValue::what_alternative() const
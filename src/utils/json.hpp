@@ -9,6 +9,8 @@
 
 #include "to_json.hpp"
 
+template <class T> struct OrError;
+
 namespace json {
 
 struct null_t {};
@@ -53,8 +55,11 @@ struct JsonValue {
 
   std::string to_string() const;
 
+  // Asserts that the json is valid, use parse for input that might not be
   static JsonValue of_string(const std::string& str);
 
+  static OrError<JsonValue> parse(const std::string& str);
+
   std::string what_alternative() const;
 };
 
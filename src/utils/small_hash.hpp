@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cstdint>
 
 uint32_t hash32(uint32_t x);
@@ -1,11 +1,24 @@
 
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <map>
 #include <queue>
+#ifdef _WASM_THREADS
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
 
+#include "engine/binary_solutions.hpp"
+#include "engine/engine.hpp"
 #include "engine/game_state.hpp"
 #include "engine/hash_game_state.hpp"
+#include "engine/opening_book.hpp"
+#include "engine/search_budget.hpp"
+#include "engine/simulation_cache.hpp"
 #include "engine/simulator.hpp"
 #include "utils/format_vector.hpp"
 #include "utils/json.hpp"
@@ -26,6 +39,120 @@ template <> struct to_string<json::JsonValue> {
 
 namespace {
 
+struct ThinkingWord {
+  InternalString word;
+  int depth;
+};
+
+// What a slice of thinking got to, the words that finished a depth and the
+// ones that are still at it. Once done there's nothing left to think about.
+struct ThinkingStep {
+  vector<WordInfo> updates;
+  bool done;
+  vector<ThinkingWord> thinking;
+};
+
+} // namespace
+
+namespace json {
+
+template <> struct to_json_t<ThinkingStep> {
+  static JsonValue convert(const ThinkingStep& value)
+  {
+    vector<JsonValue> thinking;
+    for (const auto& t : value.thinking) {
+      map<string, JsonValue> word{
+        {"word", to_json(t.word)},
+        {"depth", to_json(t.depth)},
+      };
+      thinking.push_back(to_json(word));
+    }
+    map<string, JsonValue> obj{
+      {"updates", to_json(value.updates)},
+      {"done", to_json(value.done)},
+      {"thinking", to_json(thinking)},
+    };
+    return to_json(obj);
+  }
+};
+
+} // namespace json
+
+namespace {
+
+#ifdef _WASM_THREADS
+// Threads started once for the whole game, a slice of thinking only wakes
+// them up. Each round the caller runs the first task and thread i the i-th.
+class ThinkerPool {
+ public:
+  ThinkerPool(int num_threads)
+  {
+    for (int i = 1; i < num_threads; i++) {
+      _threads.emplace_back([this, i]() { _work(i); });
+    }
+  }
+
+  ~ThinkerPool()
+  {
+    {
+      lock_guard<mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _start.notify_all();
+    for (auto& t : _threads) { t.join(); }
+  }
+
+  // Runs task(i) for every i below num_tasks, which is at most the number of
+  // threads, and returns once all of them are done
+  void run(int num_tasks, const function<void(int)>& task)
+  {
+    assert(num_tasks >= 1 && num_tasks <= int(_threads.size()) + 1);
+    {
+      lock_guard<mutex> lock(_mutex);
+      _task = &task;
+      _num_tasks = num_tasks;
+      _pending = num_tasks - 1;
+      _round++;
+    }
+    _start.notify_all();
+    task(0);
+    unique_lock<mutex> lock(_mutex);
+    _done.wait(lock, [&]() { return _pending == 0; });
+    _task = nullptr;
+  }
+
+ private:
+  void _work(int i)
+  {
+    int last_round = 0;
+    while (true) {
+      const function<void(int)>* task = nullptr;
+      {
+        unique_lock<mutex> lock(_mutex);
+        _start.wait(lock, [&]() { return _stopping || _round != last_round; });
+        if (_stopping) return;
+        last_round = _round;
+        if (i >= _num_tasks) continue;
+        task = _task;
+      }
+      (*task)(i);
+      lock_guard<mutex> lock(_mutex);
+      if (--_pending == 0) { _done.notify_one(); }
+    }
+  }
+
+  vector<thread> _threads;
+  mutex _mutex;
+  condition_variable _start;
+  condition_variable _done;
+  const function<void(int)>* _task = nullptr;
+  int _num_tasks = 0;
+  int _pending = 0;
+  int _round = 0;
+  bool _stopping = false;
+};
+#endif
+
 struct State {
  public:
   State(
@@ -34,9 +161,12 @@ struct State {
     bool hard_mode)
       : _game_state(allowed_guesses, possible_secrets, hard_mode),
         _cache_pair(1 << 24),
-        _engine(_cache_pair, false),
-        _simulator(_engine)
+        _simulation_cache(1 << 16)
   {
+    for (int i = 0; i < num_thinkers(); i++) {
+      _thinkers.push_back(
+        make_unique<Thinker>(_cache_pair, _simulation_cache));
+    }
     _game_state.validate_words().force();
     sort_guesses();
 
@@ -49,6 +179,11 @@ struct State {
     _game_state = move(_history.back());
     _reset_thinking();
     _history.pop_back();
+    _moves.pop_back();
+    if (_history.size() < _binary_solutions_depth) {
+      _binary_solutions = nullopt;
+      _binary_buffer = nullptr;
+    }
     return true;
   }
 
@@ -57,6 +192,7 @@ struct State {
     assert(_is_allowed_guess(guess) && "Word is not an allowed guess");
 
     _history.push_back(_game_state);
+    _moves.emplace_back(guess, match);
     _game_state.make_guess(guess, match);
 
     sort_guesses();
@@ -68,45 +204,110 @@ struct State {
       _game_state.possible_secrets().size());
   }
 
-  OrError<optional<WordInfo>> compute_next_suggestion()
+  // Thinks for about the time slice, a word that doesn't finish its depth in
+  // time is resumed by the next call. The searches it finished are kept in
+  // the caches, so the next call only searches what's left. With threads
+  // every thinker gets a word and they think at the same time.
+  OrError<ThinkingStep> compute_next_suggestion(int time_slice_ms)
   {
-    bool should_add_new_word = _added_new_word_counter < 8;
-    if (
-      _thinking_words.size() < 20 &&
-      _next_thinking_word < _game_state.allowed_guesses().size() &&
-      (should_add_new_word || _thinking_words.empty())) {
-      _thinking_words.push({
-        .word = _game_state.allowed_guesses().at(_next_thinking_word),
-        .max_depth = 1,
-        .best_avg_guess = 0,
-      });
-      _next_thinking_word++;
-      _added_new_word_counter++;
-    } else {
-      _added_new_word_counter = 0;
+    if (!_checked_book) {
+      _checked_book = true;
+      const auto* entry = _opening_book.find(_game_state);
+      if (entry != nullptr) {
+        // The book has the move, no need to think about the other words
+        _next_thinking_word = _game_state.allowed_guesses().size();
+        return ThinkingStep{
+          .updates = {entry->info}, .done = false, .thinking = {}};
+      }
     }
 
-    if (_thinking_words.empty()) { return nullopt; }
+    vector<Thinker*> busy;
+    for (auto& thinker : _thinkers) {
+      if (!thinker->word.has_value()) { thinker->word = _pick_thinking_word(); }
+      if (thinker->word.has_value()) { busy.push_back(thinker.get()); }
+    }
+    if (busy.empty()) {
+      return ThinkingStep{.updates = {}, .done = true, .thinking = {}};
+    }
 
-    WordState thinking_word = _thinking_words.top();
-    _thinking_words.pop();
+    _run_thinkers(
+      busy, SearchBudget::with_timeout(chrono::milliseconds(time_slice_ms)));
+
+    ThinkingStep step{.updates = {}, .done = false, .thinking = {}};
+    optional<Error> error;
+    for (auto* thinker : busy) {
+      WordState thinking_word = *thinker->word;
+      auto& out_or_error = *thinker->result;
+      if (out_or_error.is_error()) {
+        if (thinker->engine.budget_exhausted()) {
+          step.thinking.push_back(ThinkingWord{
+            .word = thinking_word.word, .depth = thinking_word.max_depth});
+        } else {
+          thinker->word = nullopt;
+          error = out_or_error.error();
+        }
+        continue;
+      }
+      thinker->word = nullopt;
+      auto& out = out_or_error.value();
+
+      if (!out.can_stop && thinking_word.max_depth < 16) {
+        thinking_word.max_depth++;
+        thinking_word.best_avg_guess =
+          max(thinking_word.best_avg_guess, out.avg_guesses);
+        _thinking_words.push(thinking_word);
+      } else {
+        // The word may have been simulated by any of them
+        for (auto& t : _thinkers) { t->simulator.forget(thinking_word.word); }
+      }
+      step.updates.push_back(move(out));
+    }
+    if (error.has_value()) { return *error; }
+    return step;
+  }
 
-    bail(
-      out,
-      _simulator.simulate(
-        _game_state, thinking_word.word, thinking_word.max_depth));
+  string cache_key() { return _game_state.hash(); }
 
-    if (!out.can_stop && thinking_word.max_depth < 16) {
-      thinking_word.max_depth++;
-      thinking_word.best_avg_guess =
-        max(thinking_word.best_avg_guess, out.avg_guesses);
-      _thinking_words.push(thinking_word);
+  OrError<int> load_opening_book(const string& book_json)
+  {
+    bail(book_value, json::JsonValue::parse(book_json));
+    bail(book, OpeningBook::of_json(book_value));
+    _opening_book = move(book);
+    for (auto& thinker : _thinkers) {
+      thinker->engine.set_opening_book(&_opening_book);
     }
+    _reset_thinking();
+    return _opening_book.size();
+  }
 
+  // Takes ownership of a buffer allocated with malloc holding the binary
+  // solutions of the current state, the solutions are read from it in place.
+  OrError<vector<WordInfo>> load_binary_solutions(uint8_t* data, size_t size)
+  {
+    _binary_solutions = nullopt;
+    _binary_buffer.reset(data);
+    bail(
+      solutions,
+      BinarySolutions::of_buffer(data, size, _game_state.allowed_guesses()));
+    _binary_solutions = move(solutions);
+    _binary_solutions_depth = _history.size();
+
+    vector<WordInfo> out;
+    for (int i = 0; i < _binary_solutions->size(); i++) {
+      out.push_back(_binary_solutions->word_info(i));
+    }
     return out;
   }
 
-  string cache_key() { return _game_state.hash(); }
+  // The move of the loaded decision trees for the current state, if the
+  // guesses played since loading them followed the trees
+  optional<WordInfo> binary_tree_move()
+  {
+    if (!_binary_solutions.has_value()) return nullopt;
+    vector<pair<InternalString, Match>> moves(
+      _moves.begin() + _binary_solutions_depth, _moves.end());
+    return _binary_solutions->next_move(moves);
+  }
 
  private:
   struct WordState {
@@ -120,16 +321,50 @@ struct State {
     }
   };
 
+  // Thinks about one word at a time with its own engine, all of them share
+  // the caches. A word stays with its thinker until it finishes its depth.
+  struct Thinker {
+    Thinker(CachePair& cache_pair, SimulationCache& simulation_cache)
+        : engine(cache_pair, false), simulator(engine)
+    {
+      simulator.set_simulation_cache(simulation_cache);
+    }
+
+    Engine engine;
+    Simulator simulator;
+    optional<WordState> word;
+    optional<OrError<WordInfo>> result;
+  };
+
+  static int num_thinkers()
+  {
+#ifdef _WASM_THREADS
+    return max<int>(1, thread::hardware_concurrency());
+#else
+    return 1;
+#endif
+  }
+
   priority_queue<WordState> _thinking_words;
   size_t _next_thinking_word = 0;
   int _added_new_word_counter = 0;
 
   GameState _game_state;
+  OpeningBook _opening_book;
+  bool _checked_book = false;
   CachePair _cache_pair;
-  Engine _engine;
-  Simulator _simulator;
+  SimulationCache _simulation_cache;
+  vector<unique_ptr<Thinker>> _thinkers;
+#ifdef _WASM_THREADS
+  ThinkerPool _pool{num_thinkers()};
+#endif
 
   vector<GameState> _history;
+  vector<pair<InternalString, Match>> _moves;
+
+  unique_ptr<uint8_t, decltype(&free)> _binary_buffer{nullptr, &free};
+  optional<BinarySolutions> _binary_solutions;
+  size_t _binary_solutions_depth = 0;
 
   void sort_guesses()
   {
@@ -145,10 +380,51 @@ struct State {
     return false;
   }
 
+  optional<WordState> _pick_thinking_word()
+  {
+    bool should_add_new_word = _added_new_word_counter < 8;
+    if (
+      _thinking_words.size() < 20 &&
+      _next_thinking_word < _game_state.allowed_guesses().size() &&
+      (should_add_new_word || _thinking_words.empty())) {
+      _thinking_words.push({
+        .word = _game_state.allowed_guesses().at(_next_thinking_word),
+        .max_depth = 1,
+        .best_avg_guess = 0,
+      });
+      _next_thinking_word++;
+      _added_new_word_counter++;
+    } else {
+      _added_new_word_counter = 0;
+    }
+
+    if (_thinking_words.empty()) { return nullopt; }
+    WordState word = _thinking_words.top();
+    _thinking_words.pop();
+    return word;
+  }
+
+  void _run_thinkers(
+    const vector<Thinker*>& thinkers, const SearchBudget& budget)
+  {
+    auto run = [&](Thinker& thinker) {
+      thinker.engine.set_budget(budget);
+      thinker.result = thinker.simulator.simulate(
+        _game_state, thinker.word->word, thinker.word->max_depth);
+    };
+#ifdef _WASM_THREADS
+    _pool.run(thinkers.size(), [&](int i) { run(*thinkers[i]); });
+#else
+    for (auto* thinker : thinkers) { run(*thinker); }
+#endif
+  }
+
   void _reset_thinking()
   {
     while (!_thinking_words.empty()) { _thinking_words.pop(); }
+    for (auto& thinker : _thinkers) { thinker->word = nullopt; }
     _next_thinking_word = 0;
+    _checked_book = false;
   }
 };
 
@@ -210,9 +486,9 @@ void load_dict(const char* dict_json)
 }
 
 EMSCRIPTEN_KEEPALIVE
-const char* compute_next_suggestion()
+const char* compute_next_suggestion(int time_slice_ms)
 {
-  auto out = state->compute_next_suggestion();
+  auto out = state->compute_next_suggestion(time_slice_ms);
   return_string = json::to_json(out).to_string();
   return return_string.data();
 }
@@ -237,5 +513,29 @@ const char* cache_key()
   return return_string.data();
 }
 
+// The buffer must be allocated with malloc, the engine frees it
+EMSCRIPTEN_KEEPALIVE
+const char* load_binary_solutions(uint8_t* data, int size)
+{
+  auto out = state->load_binary_solutions(data, size);
+  return_string = json::to_json(out).to_string();
+  return return_string.data();
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* load_opening_book(const char* book_json)
+{
+  auto out = state->load_opening_book(book_json);
+  return_string = json::to_json(out).to_string();
+  return return_string.data();
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* binary_tree_move()
+{
+  return_string = json::to_json(state->binary_tree_move()).to_string();
+  return return_string.data();
+}
+
 // extern C
 }
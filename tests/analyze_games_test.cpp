@@ -0,0 +1,133 @@
+#include "test.hpp"
+
+#include <deque>
+#include <map>
+#include <optional>
+#include <sstream>
+
+#include "analyze_games.hpp"
+#include "engine/match.hpp"
+#include "utils/json.hpp"
+
+using namespace std;
+using json::JsonValue;
+
+namespace {
+
+// One game of the small words, played to adult unless another game is given,
+// analyzed with the extra flags
+struct AnalyzedGame {
+  AnalyzedGame(const deque<string>& extra_args, string game_line = "")
+  {
+    const string dir = test::temp_dir();
+    const string words =
+      test::write_dictionary(dir, "words", test::small_words());
+    test::load_dictionary(words);
+    if (game_line.empty()) {
+      const string pattern =
+        Match::match(InternalString("about"), InternalString("adult")).str();
+      game_line = "about " + pattern + " adult !!!!!";
+    }
+    const string games = dir + "/games";
+    test::write_file(games, game_line + "\n");
+    const string output = dir + "/output";
+
+    deque<string> args{
+      "--allowed-guesses-file",
+      words,
+      "--games-file",
+      games,
+      "--output-file",
+      output,
+    };
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
+    exit_code = AnalyzeGames::command().run(args);
+    if (exit_code != 0) return;
+
+    istringstream lines(test::read_file(output));
+    string line;
+    while (getline(lines, line)) {
+      auto game = JsonValue::parse(line);
+      if (game.is_error()) {
+        parsed = false;
+        return;
+      }
+      const auto& obj = game.value().get_object();
+      if (obj.count("error") == 1) { error = obj.at("error").get_string(); }
+      for (const auto& step : obj.at("steps").get_list()) {
+        steps.push_back(step.get_object());
+      }
+    }
+  }
+
+  int exit_code;
+  bool parsed = true;
+  optional<string> error;
+  vector<map<string, JsonValue>> steps;
+};
+
+// A step that was answered got a real answer, a search cut off at the root
+// only has the first secret with as many guesses as there are secrets. With
+// a single secret left that is the answer.
+bool is_answered(const map<string, JsonValue>& step)
+{
+  if (step.count("best_guess") == 0) return false;
+  const int num_secrets = step.at("remaining_secrets").get_int();
+  return num_secrets == 1 || step.at("num_guesses").get_int() < num_secrets;
+}
+
+bool is_out_of_budget(const map<string, JsonValue>& step)
+{
+  return step.count("error") == 1 &&
+         step.at("error").get_string() == "Search budget exhausted";
+}
+
+} // namespace
+
+TEST(analyze_games_solves_every_step)
+{
+  AnalyzedGame game({});
+  REQUIRE(game.exit_code == 0);
+  REQUIRE(game.parsed);
+  REQUIRE(game.steps.size() == 2);
+  for (const auto& step : game.steps) {
+    CHECK(is_answered(step));
+    CHECK(step.at("is_optimal").get_string() == "true");
+  }
+  CHECK(game.steps[0].at("remaining_secrets").get_int() == 40);
+}
+
+// Out of time a step either has the last depth that finished or the error,
+// never what the cut off search was holding
+TEST(analyze_games_with_tiny_time_limit)
+{
+  for (const string time_limit_ms : {"0", "1"}) {
+    AnalyzedGame game({"--time-limit-ms", time_limit_ms});
+    REQUIRE(game.exit_code == 0);
+    REQUIRE(game.parsed);
+    REQUIRE(game.steps.size() == 2);
+    for (const auto& step : game.steps) {
+      CHECK(is_answered(step) || is_out_of_budget(step));
+    }
+  }
+}
+
+TEST(analyze_games_rejects_max_depth_below_one)
+{
+  AnalyzedGame game({"--max-depth", "0"});
+  CHECK(game.exit_code != 0);
+}
+
+TEST(analyze_games_rejects_impossible_secret)
+{
+  // adult leaves the words starting with a but no d, u, l or t, not about
+  AnalyzedGame game({}, "adult !XXXX about !!!!!");
+  REQUIRE(game.exit_code == 0);
+  REQUIRE(game.parsed);
+  REQUIRE(game.error.has_value());
+  CHECK(test::contains(*game.error, "about"));
+
+  AnalyzedGame played({});
+  REQUIRE(played.exit_code == 0);
+  CHECK(!played.error.has_value());
+}
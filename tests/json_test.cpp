@@ -0,0 +1,82 @@
+#include "test.hpp"
+
+#include <map>
+
+#include "utils/error.hpp"
+#include "utils/json.hpp"
+
+using namespace std;
+using json::JsonValue;
+
+namespace {
+
+// Whether parsing fails with a message that has the part in it
+bool fails_with(const string& str, const string& part)
+{
+  auto value = JsonValue::parse(str);
+  return value.is_error() && test::contains(value.error().msg(), part);
+}
+
+} // namespace
+
+TEST(json_parses_requests)
+{
+  auto value = JsonValue::parse(
+    " {\"id\": 7, \"moves\": [[\"raise\", \"XX!?X\"]], \"hard\": true} ");
+  REQUIRE(!value.is_error());
+  const auto& obj = value.value().get_object();
+  CHECK(obj.at("id").get_int() == 7);
+  CHECK(obj.at("hard").get_string() == "true");
+  const auto& moves = obj.at("moves").get_list();
+  REQUIRE(moves.size() == 1);
+  CHECK(moves[0].get_list()[0].get_string() == "raise");
+  CHECK(moves[0].get_list()[1].get_string() == "XX!?X");
+}
+
+TEST(json_parses_numbers)
+{
+  auto negative = JsonValue::parse("-3");
+  REQUIRE(!negative.is_error());
+  CHECK(negative.value().get_int() == -3);
+
+  auto fraction = JsonValue::parse("[2.5, 1e3]");
+  REQUIRE(!fraction.is_error());
+  CHECK(fraction.value().get_list()[0].get_double() == 2.5);
+  CHECK(fraction.value().get_list()[1].get_double() == 1000);
+}
+
+TEST(json_round_trips_to_string)
+{
+  const vector<int> list{1, 2};
+  const vector<int> empty;
+  map<string, JsonValue> obj{
+    {"guess", json::to_json(string("raise"))},
+    {"num_guesses", json::to_json(3)},
+    {"list", json::to_json(list)},
+    {"empty", json::to_json(empty)},
+  };
+  const string str = json::to_json(obj).to_string();
+  auto value = JsonValue::parse(str);
+  REQUIRE(!value.is_error());
+  CHECK(value.value().to_string() == str);
+}
+
+TEST(json_fails_on_invalid_input)
+{
+  CHECK(fails_with("", "Unexpected end of json"));
+  CHECK(fails_with("   ", "Unexpected end of json"));
+  CHECK(fails_with("{", "Unexpected end of json"));
+  CHECK(fails_with("[1,", "Unexpected end of json"));
+  CHECK(fails_with("[1 2]", "expected , or ] in list"));
+  CHECK(fails_with("{\"a\" 1}", "expected : after object key"));
+  CHECK(fails_with("{\"a\": 1", "unterminated object"));
+  CHECK(fails_with("{\"a\": 1 \"b\": 2}", "expected , or } in object"));
+  CHECK(fails_with("{1: 2}", "expected a string"));
+  CHECK(fails_with("\"abc", "unterminated string"));
+  CHECK(fails_with("1 2", "expected the end of the json"));
+  CHECK(fails_with("{} {}", "expected the end of the json"));
+  CHECK(fails_with("--1", "Invalid number"));
+  CHECK(fails_with("1.2.3", "Invalid number"));
+  CHECK(fails_with("99999999999", "Invalid number"));
+  CHECK(fails_with("@", "unexpected character"));
+}
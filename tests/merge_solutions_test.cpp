@@ -0,0 +1,154 @@
+#include "test.hpp"
+
+#include <cstdio>
+#include <deque>
+
+#include "engine/game_state.hpp"
+#include "merge_solutions.hpp"
+#include "solution_file.hpp"
+
+using namespace std;
+
+namespace {
+
+// Two shards of the small words, each with a complete manifest and two
+// solutions, the best of them in the second shard
+struct ShardedRun {
+  ShardedRun()
+      : dir(test::temp_dir()),
+        words(test::write_dictionary(dir, "words", test::small_words()))
+  {
+    auto allowed = test::load_dictionary(words);
+    state_hash = GameState(allowed, allowed, false).hash();
+    write_shard(0, "build", {{"aback", 3.5, 5}, {"abase", 3.75, 5}});
+    write_shard(1, "build", {{"abate", 3.25, 4}, {"abbey", 4, 6}});
+  }
+
+  struct Solution {
+    string guess;
+    double avg_guesses;
+    int worst;
+  };
+
+  SolutionFile shard_file(int index) const
+  {
+    return SolutionFile(dir, state_hash, Shard{.index = index, .count = 2});
+  }
+
+  void write_shard(
+    int index, const string& build_id, const vector<Solution>& solutions)
+  {
+    vector<WordInfo> infos;
+    for (const auto& s : solutions) {
+      infos.push_back(test::word_info(s.guess, s.avg_guesses, s.worst));
+    }
+    CHECK(!shard_file(index).write_partial(infos).is_error());
+    write_manifest(index, build_id, true);
+  }
+
+  void write_manifest(int index, const string& build_id, bool complete)
+  {
+    SolutionManifest manifest{
+      .build_id = build_id,
+      .parameters = {{"max_words", "4"}},
+      .complete = complete,
+    };
+    CHECK(!shard_file(index).write_manifest(manifest).is_error());
+  }
+
+  int merge(const deque<string>& extra_args = {}) const
+  {
+    deque<string> args{
+      "--allowed-guesses-file",
+      words,
+      "--write-solutions-dir",
+      dir,
+      "--shards",
+      "2",
+    };
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
+    return MergeSolutions::command().run(args);
+  }
+
+  OrError<optional<vector<WordInfo>>> merged() const
+  {
+    return SolutionFile(dir, state_hash).read_solutions();
+  }
+
+  string dir;
+  string words;
+  string state_hash;
+};
+
+} // namespace
+
+TEST(merge_solutions_merges_complete_shards)
+{
+  ShardedRun run;
+  REQUIRE(run.merge() == 0);
+
+  auto solutions = run.merged();
+  REQUIRE(!solutions.is_error());
+  REQUIRE(solutions.value().has_value());
+  const auto& merged = *solutions.value();
+  REQUIRE(merged.size() == 4);
+  CHECK(merged[0].first_guess == InternalString("abate"));
+  CHECK(merged[1].first_guess == InternalString("aback"));
+  CHECK(merged[3].first_guess == InternalString("abbey"));
+
+  auto manifest = SolutionFile(run.dir, run.state_hash).read_manifest();
+  REQUIRE(!manifest.is_error());
+  REQUIRE(manifest.value().has_value());
+  CHECK(manifest.value()->complete);
+  CHECK(manifest.value()->build_id == "build");
+  CHECK(manifest.value()->parameters.at("max_words") == "4");
+}
+
+TEST(merge_solutions_keeps_the_best_words)
+{
+  ShardedRun run;
+  REQUIRE(run.merge({"--solutions-max-words", "2"}) == 0);
+
+  auto solutions = run.merged();
+  REQUIRE(!solutions.is_error());
+  REQUIRE(solutions.value().has_value());
+  REQUIRE(solutions.value()->size() == 2);
+  CHECK(solutions.value()->at(0).first_guess == InternalString("abate"));
+  CHECK(solutions.value()->at(1).first_guess == InternalString("aback"));
+}
+
+TEST(merge_solutions_fails_on_incomplete_shard)
+{
+  ShardedRun run;
+  run.write_manifest(1, "build", false);
+  CHECK(run.merge() != 0);
+
+  auto solutions = run.merged();
+  REQUIRE(!solutions.is_error());
+  CHECK(!solutions.value().has_value());
+}
+
+TEST(merge_solutions_fails_on_missing_manifest)
+{
+  ShardedRun run;
+  CHECK(remove(run.shard_file(0).manifest_path().c_str()) == 0);
+  CHECK(run.merge() != 0);
+}
+
+TEST(merge_solutions_fails_on_other_build)
+{
+  ShardedRun run;
+  run.write_manifest(1, "other build", true);
+  CHECK(run.merge() != 0);
+
+  auto solutions = run.merged();
+  REQUIRE(!solutions.is_error());
+  CHECK(!solutions.value().has_value());
+}
+
+TEST(merge_solutions_fails_on_missing_partial)
+{
+  ShardedRun run;
+  CHECK(remove(run.shard_file(1).partial_path().c_str()) == 0);
+  CHECK(run.merge() != 0);
+}
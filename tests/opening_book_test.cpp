@@ -0,0 +1,64 @@
+#include "test.hpp"
+
+#include <deque>
+
+#include "engine/game_state.hpp"
+#include "engine/match.hpp"
+#include "engine/opening_book.hpp"
+#include "evaluate.hpp"
+#include "solution_file.hpp"
+#include "utils/json.hpp"
+
+using namespace std;
+using json::JsonValue;
+
+// The simulator hands the engine views that keep every allowed guess and the
+// web page guesses on a sorted state that drops them, both find the states
+// the book was built with
+TEST(opening_book_finds_states_after_first_guess)
+{
+  const string dir = test::temp_dir();
+  const string words =
+    test::write_dictionary(dir, "words", test::small_words());
+  const deque<string> args{
+    "--allowed-guesses-file",
+    words,
+    "--write-solutions-dir",
+    dir,
+    "--max-words",
+    "1",
+    "--opening-book-words",
+    "1",
+  };
+  REQUIRE(Evaluate::command().run(args) == 0);
+
+  auto allowed = test::load_dictionary(words);
+  const GameState root(allowed, allowed, false);
+  const SolutionFile solution_file(dir, root.hash());
+  auto solutions = solution_file.read_solutions();
+  REQUIRE(!solutions.is_error());
+  REQUIRE(solutions.value().has_value());
+  REQUIRE(!solutions.value()->empty());
+  const InternalString first_guess = solutions.value()->front().first_guess;
+
+  auto json = JsonValue::parse(
+    test::read_file(solution_file.opening_book_path()));
+  REQUIRE(!json.is_error());
+  auto book = OpeningBook::of_json(json.value());
+  REQUIRE(!book.is_error());
+
+  int num_states = 0;
+  const GameStateView root_view(root);
+  for (const auto& b : root.partition_by_pattern(first_guess)) {
+    if (b.size() < 3) continue;
+    num_states++;
+    CHECK(book.value().find(root_view.view_from_partition(b)) != nullptr);
+
+    GameState played = root;
+    played.sort_guesses_by_greedy(false);
+    CHECK(!played.make_guess(first_guess, b.match()).is_error());
+    CHECK(book.value().find(played) != nullptr);
+  }
+  CHECK(num_states > 0);
+  CHECK(book.value().size() == num_states);
+}
@@ -0,0 +1,83 @@
+#include "test.hpp"
+
+#include <chrono>
+#include <memory>
+
+#include "engine/avg_engine.hpp"
+#include "engine/engine.hpp"
+#include "engine/game_state.hpp"
+#include "engine/search_budget.hpp"
+
+using namespace std;
+
+namespace {
+
+GameState small_game_state()
+{
+  const string dir = test::temp_dir();
+  auto words = test::load_dictionary(
+    test::write_dictionary(dir, "words", test::small_words()));
+  return GameState(words, words, false);
+}
+
+CancellationToken cancelled_token()
+{
+  CancellationToken token;
+  token.cancel();
+  return token;
+}
+
+} // namespace
+
+TEST(engine_search_finishes_without_budget)
+{
+  const GameState game_state = small_game_state();
+  auto cache_pair = make_unique<CachePair>(1 << 16);
+  Engine engine(*cache_pair, false);
+  auto result = engine.search(game_state, 4);
+  REQUIRE(!result.is_error());
+  CHECK(!engine.budget_exhausted());
+  CHECK(result.value().num_guesses <= 4);
+}
+
+// A search cut off by the budget fails rather than passing its placeholder
+// on as an answer
+TEST(engine_search_fails_when_cancelled)
+{
+  const GameState game_state = small_game_state();
+  auto cache_pair = make_unique<CachePair>(1 << 16);
+  Engine engine(*cache_pair, false);
+  engine.set_budget(SearchBudget(nullopt, cancelled_token()));
+  auto result = engine.search(game_state, 4);
+  REQUIRE(result.is_error());
+  CHECK(result.error().msg() == "Search budget exhausted");
+  CHECK(engine.budget_exhausted());
+
+  // Another budget lets the same engine finish
+  engine.set_budget(SearchBudget::unlimited());
+  CHECK(!engine.search(game_state, 4).is_error());
+  CHECK(!engine.budget_exhausted());
+}
+
+TEST(engine_search_fails_after_timeout)
+{
+  const GameState game_state = small_game_state();
+  auto cache_pair = make_unique<CachePair>(1 << 16);
+  Engine engine(*cache_pair, false);
+  engine.set_budget(SearchBudget::with_timeout(chrono::milliseconds(0)));
+  auto result = engine.search(game_state, 4);
+  REQUIRE(result.is_error());
+  CHECK(engine.budget_exhausted());
+}
+
+TEST(avg_engine_search_fails_when_cancelled)
+{
+  const GameState game_state = small_game_state();
+  auto cache = make_unique<Cache>(1 << 16);
+  AvgEngine engine(*cache, 10);
+  engine.set_budget(SearchBudget(nullopt, cancelled_token()));
+  auto result = engine.search(game_state, 4);
+  REQUIRE(result.is_error());
+  CHECK(result.error().msg() == "Search budget exhausted");
+  CHECK(engine.budget_exhausted());
+}
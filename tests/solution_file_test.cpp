@@ -0,0 +1,195 @@
+#include "test.hpp"
+
+#include <deque>
+
+#include "engine/game_state.hpp"
+#include "evaluate.hpp"
+#include "solution_file.hpp"
+
+using namespace std;
+
+namespace {
+
+bool append(
+  const SolutionFile& solution_file,
+  const string& guess,
+  double avg_guesses,
+  int worst)
+{
+  const WordInfo info = test::word_info(guess, avg_guesses, worst);
+  return !solution_file.append_progress(info).is_error();
+}
+
+} // namespace
+
+TEST(progress_log_round_trip)
+{
+  const string dir = test::temp_dir();
+  const SolutionFile solution_file(dir, "state");
+  CHECK(append(solution_file, "aback", 3, 4));
+  CHECK(append(solution_file, "abase", 3.5, 5));
+
+  auto done = solution_file.read_progress();
+  REQUIRE(!done.is_error());
+  REQUIRE(done.value().size() == 2);
+  const auto& info = done.value()[1];
+  CHECK(info.first_guess == InternalString("abase"));
+  CHECK(info.avg_guesses == 3.5);
+  CHECK(info.worst_num_guesses == 5);
+  const WordInfo expected = test::word_info("abase", 3.5, 5);
+  CHECK(info.guess_distribution == expected.guess_distribution);
+  CHECK(
+    info.cumulative_guess_distribution ==
+    expected.cumulative_guess_distribution);
+  CHECK(info.most_difficult_secret == InternalString("abbey"));
+  CHECK(info.max_depth == 3);
+  CHECK(info.all_matches == expected.all_matches);
+  CHECK(info.can_stop);
+}
+
+TEST(progress_log_drops_torn_final_line)
+{
+  const string dir = test::temp_dir();
+  const SolutionFile solution_file(dir, "state");
+  CHECK(append(solution_file, "aback", 3, 4));
+  const string complete = test::read_file(solution_file.progress_path());
+  test::write_file(
+    solution_file.progress_path(), complete + "{\"guess\":\"aba");
+
+  auto done = solution_file.read_progress();
+  REQUIRE(!done.is_error());
+  CHECK(done.value().size() == 1);
+  CHECK(test::read_file(solution_file.progress_path()) == complete);
+
+  // The next record starts on its own line
+  CHECK(append(solution_file, "abase", 3.5, 5));
+  auto again = solution_file.read_progress();
+  REQUIRE(!again.is_error());
+  CHECK(again.value().size() == 2);
+}
+
+TEST(progress_log_fails_on_corrupted_line)
+{
+  const string dir = test::temp_dir();
+  const SolutionFile solution_file(dir, "state");
+  CHECK(append(solution_file, "aback", 3, 4));
+  const string first = test::read_file(solution_file.progress_path());
+  test::write_file(
+    solution_file.progress_path(), first + "{\"guess\": [1,\n" + first);
+
+  auto done = solution_file.read_progress();
+  REQUIRE(done.is_error());
+  CHECK(test::contains(
+    done.error().msg(), solution_file.progress_path() + ":2:"));
+
+  // A line that parses but isn't a record fails the same way
+  test::write_file(solution_file.progress_path(), first + "[1, 2]\n");
+  auto not_record = solution_file.read_progress();
+  REQUIRE(not_record.is_error());
+  CHECK(test::contains(
+    not_record.error().msg(), solution_file.progress_path() + ":2:"));
+}
+
+TEST(evaluate_resumes_from_progress_log)
+{
+  const string dir = test::temp_dir();
+  const string words =
+    test::write_dictionary(dir, "words", test::small_words());
+  const deque<string> args{
+    "--allowed-guesses-file",
+    words,
+    "--write-solutions-dir",
+    dir,
+    "--max-words",
+    "2",
+    "--no-pruning",
+  };
+  REQUIRE(Evaluate::command().run(args) == 0);
+
+  auto allowed = test::load_dictionary(words);
+  const string state_hash = GameState(allowed, allowed, false).hash();
+  const SolutionFile solution_file(dir, state_hash);
+  auto done = solution_file.read_progress();
+  REQUIRE(!done.is_error());
+  REQUIRE(done.value().size() == 2);
+
+  // A word in the log isn't searched again, whatever the log says is kept
+  WordInfo edited = done.value()[0];
+  edited.worst_num_guesses = 9;
+  edited.guess_distribution = {{9, int(allowed.size())}};
+  edited.avg_guesses = 9;
+  CHECK(!solution_file.clear_progress().is_error());
+  CHECK(!solution_file.append_progress(edited).is_error());
+
+  deque<string> resume_args = args;
+  resume_args.push_back("--resume");
+  REQUIRE(Evaluate::command().run(resume_args) == 0);
+
+  auto solutions = solution_file.read_solutions();
+  REQUIRE(!solutions.is_error());
+  REQUIRE(solutions.value().has_value());
+  REQUIRE(solutions.value()->size() == 2);
+  const auto& worst = solutions.value()->back();
+  CHECK(worst.first_guess == edited.first_guess);
+  CHECK(worst.worst_num_guesses == 9);
+
+  auto progress = solution_file.read_progress();
+  REQUIRE(!progress.is_error());
+  CHECK(progress.value().size() == 2);
+}
+
+TEST(evaluate_refuses_to_resume_another_run)
+{
+  const string dir = test::temp_dir();
+  const string words =
+    test::write_dictionary(dir, "words", test::small_words());
+  deque<string> args{
+    "--allowed-guesses-file",
+    words,
+    "--write-solutions-dir",
+    dir,
+    "--max-words",
+    "2",
+    "--no-pruning",
+    "--resume",
+  };
+  // Without a manifest nothing says which run the log is from
+  CHECK(Evaluate::command().run(args) != 0);
+
+  args.pop_back();
+  REQUIRE(Evaluate::command().run(args) == 0);
+
+  auto allowed = test::load_dictionary(words);
+  const SolutionFile solution_file(
+    dir, GameState(allowed, allowed, false).hash());
+  const string manifest = test::read_file(solution_file.manifest_path());
+
+  args[5] = "3";
+  args.push_back("--resume");
+  CHECK(Evaluate::command().run(args) != 0);
+  CHECK(test::read_file(solution_file.manifest_path()) == manifest);
+
+  auto progress = solution_file.read_progress();
+  REQUIRE(!progress.is_error());
+  CHECK(progress.value().size() == 2);
+}
+
+TEST(evaluate_refuses_to_resume_binary_trees)
+{
+  const string dir = test::temp_dir();
+  const string words =
+    test::write_dictionary(dir, "words", test::small_words());
+  deque<string> args{
+    "--allowed-guesses-file",
+    words,
+    "--write-solutions-dir",
+    dir,
+    "--max-words",
+    "2",
+    "--binary-trees",
+  };
+  REQUIRE(Evaluate::command().run(args) == 0);
+
+  args.push_back("--resume");
+  CHECK(Evaluate::command().run(args) != 0);
+}
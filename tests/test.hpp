@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "engine/internal_string.hpp"
+#include "engine/simulator.hpp"
+
+// A minimal test runner, each TEST registers itself and make test runs them
+// all. A failed CHECK marks the test failed and goes on, a failed REQUIRE
+// also returns from it.
+
+struct RegisterTest {
+  RegisterTest(const char* name, void (*run)());
+};
+
+void check_failed(const char* file, int line, const char* expr);
+
+#define TEST(name)                                            \
+  static void name();                                         \
+  static const RegisterTest name##_registered(#name, name);   \
+  static void name()
+
+#define CHECK(cond)                                              \
+  do {                                                           \
+    if (!(cond)) { check_failed(__FILE__, __LINE__, #cond); }    \
+  } while (0)
+
+#define REQUIRE(cond)                                            \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      check_failed(__FILE__, __LINE__, #cond);                   \
+      return;                                                    \
+    }                                                            \
+  } while (0)
+
+namespace test {
+
+// A new empty directory under /tmp, removed once the tests are done
+std::string temp_dir();
+
+void write_file(const std::string& path, const std::string& contents);
+
+std::string read_file(const std::string& path);
+
+bool contains(const std::string& str, const std::string& part);
+
+// Writes the words as a dictionary file in dir and loads it like the
+// commands do, so the match table has them
+std::string write_dictionary(
+  const std::string& dir,
+  const std::string& name,
+  const std::vector<std::string>& words);
+
+std::vector<InternalString> load_dictionary(const std::string& path);
+
+// The first words of data/en-secret-words.dict, small enough that every
+// command runs on them in well under a second
+const std::vector<std::string>& small_words();
+
+// A made up strategy over 4 secrets, the worst of them takes worst guesses
+WordInfo word_info(const std::string& guess, double avg_guesses, int worst);
+
+} // namespace test
@@ -0,0 +1,150 @@
+#include "test.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "engine/dictionary.hpp"
+#include "utils/format.hpp"
+
+using namespace std;
+using namespace fmt;
+
+namespace {
+
+struct TestCase {
+  const char* name;
+  void (*run)();
+};
+
+vector<TestCase>& test_cases()
+{
+  static vector<TestCase> cases;
+  return cases;
+}
+
+vector<string>& temp_dirs()
+{
+  static vector<string> dirs;
+  return dirs;
+}
+
+int num_failed_checks = 0;
+
+Match pattern(const string& str)
+{
+  auto match = Match::parse(str);
+  return match.value();
+}
+
+} // namespace
+
+RegisterTest::RegisterTest(const char* name, void (*run)())
+{
+  test_cases().push_back(TestCase{.name = name, .run = run});
+}
+
+void check_failed(const char* file, int line, const char* expr)
+{
+  print_line("$:$: check failed: $", file, line, expr);
+  num_failed_checks++;
+}
+
+namespace test {
+
+string temp_dir()
+{
+  char dir[] = "/tmp/botle_test_XXXXXX";
+  if (mkdtemp(dir) == nullptr) {
+    print_line("Failed to create a temporary directory");
+    abort();
+  }
+  temp_dirs().push_back(dir);
+  return dir;
+}
+
+void write_file(const string& path, const string& contents)
+{
+  ofstream f(path, ios::out | ios::binary | ios::trunc);
+  f << contents;
+}
+
+string read_file(const string& path)
+{
+  ifstream f(path, ios::in | ios::binary);
+  stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+bool contains(const string& str, const string& part)
+{
+  return str.find(part) != string::npos;
+}
+
+string write_dictionary(
+  const string& dir, const string& name, const vector<string>& words)
+{
+  string contents;
+  for (const auto& word : words) { contents += word + "\n"; }
+  const string path = dir + "/" + name;
+  write_file(path, contents);
+  return path;
+}
+
+vector<InternalString> load_dictionary(const string& path)
+{
+  auto words = Dictionary::load_words(path);
+  if (words.is_error()) {
+    print_line("Failed to load $: $", path, words.error());
+    abort();
+  }
+  return words.value();
+}
+
+const vector<string>& small_words()
+{
+  static const vector<string> words{
+    "aback", "abase", "abate", "abbey", "abbot", "abhor", "abide", "abled",
+    "abode", "abort", "about", "above", "abuse", "abyss", "acorn", "acrid",
+    "actor", "acute", "adage", "adapt", "adept", "admin", "admit", "adobe",
+    "adopt", "adore", "adorn", "adult", "affix", "afire", "afoot", "afoul",
+    "after", "again", "agape", "agate", "agent", "agile", "aging", "aglow",
+  };
+  return words;
+}
+
+WordInfo word_info(const string& guess, double avg_guesses, int worst)
+{
+  WordInfo info;
+  info.first_guess = InternalString(guess);
+  info.avg_guesses = avg_guesses;
+  info.worst_num_guesses = worst;
+  info.guess_distribution = {{2, 1}, {3, 2}, {worst, 1}};
+  info.cumulative_guess_distribution = {{2, 1}, {3, 3}, {worst, 4}};
+  info.most_difficult_secret = InternalString("abbey");
+  info.max_depth = 3;
+  info.all_matches = {pattern("XXXXX"), pattern("!?X!?")};
+  info.can_stop = true;
+  return info;
+}
+
+} // namespace test
+
+int main()
+{
+  int num_failed = 0;
+  for (const auto& test_case : test_cases()) {
+    const int failed_before = num_failed_checks;
+    test_case.run();
+    const bool passed = num_failed_checks == failed_before;
+    if (!passed) { num_failed++; }
+    print_line("$ $", passed ? "PASS" : "FAIL", test_case.name);
+  }
+  for (const auto& dir : temp_dirs()) { filesystem::remove_all(dir); }
+
+  print_line("$ of $ tests passed", test_cases().size() - num_failed,
+    test_cases().size());
+  return num_failed == 0 ? 0 : 1;
+}
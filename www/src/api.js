@@ -3,10 +3,14 @@ import startEngine from './engine/botle.js';
 class EngineApi {
   constructor(instance) {
     this._load_dict = instance.cwrap("load_dict", 'null', ['string']);
-    this._compute_next_suggestion = instance.cwrap("compute_next_suggestion", 'string', []);
+    this._compute_next_suggestion = instance.cwrap("compute_next_suggestion", 'string', ['number']);
     this._make_guess = instance.cwrap("make_guess", 'null', ['string']);
     this._cache_key = instance.cwrap("cache_key", 'string', []);
     this._back = instance.cwrap("back", 'boolean', []);
+    this._load_binary_solutions = instance.cwrap("load_binary_solutions", 'string', ['number', 'number']);
+    this._binary_tree_move = instance.cwrap("binary_tree_move", 'string', []);
+    this._load_opening_book = instance.cwrap("load_opening_book", 'string', ['string']);
+    this._instance = instance;
   }
 
   load_dict(allowed_guesses, possible_secrets, hard_mode) {
@@ -28,8 +32,10 @@ class EngineApi {
     return JSON.parse(result);
   }
 
-  compute_next_suggestion() {
-    let result = this._compute_next_suggestion();
+  // Thinks for about time_slice_ms, returns the updates of the words that
+  // finished a depth and whether there's nothing left to think about
+  compute_next_suggestion(time_slice_ms) {
+    let result = this._compute_next_suggestion(time_slice_ms);
     let out = JSON.parse(result);
     if ('error' in out || !('ok' in out)) {
       throw out;
@@ -54,6 +60,29 @@ class EngineApi {
   back() {
     return this._back();
   }
+
+  // The engine keeps the bytes and frees them once they're no longer needed
+  load_binary_solutions(bytes) {
+    let ptr = this._instance._malloc(bytes.length);
+    this._instance.HEAPU8.set(bytes, ptr);
+    let out = JSON.parse(this._load_binary_solutions(ptr, bytes.length));
+    if ('error' in out || !('ok' in out)) {
+      throw out;
+    }
+    return out['ok'];
+  }
+
+  load_opening_book(book_json) {
+    let out = JSON.parse(this._load_opening_book(book_json));
+    if ('error' in out || !('ok' in out)) {
+      throw out;
+    }
+    return out['ok'];
+  }
+
+  binary_tree_move() {
+    return JSON.parse(this._binary_tree_move());
+  }
 };
 
 export function createAPI() {
@@ -130,7 +130,10 @@ export default class Thinking extends React.Component {
 
   async schedule_think() {
     let key = await this.engine().cache_key();
-    let cache = await fetch_cache(key);
+    let cache = await this.engine().load_solutions(key);
+    if (!cache) {
+      cache = await fetch_cache(key);
+    }
     if (cache) {
       console.log("Cache found");
       this.setState((state, props) => {
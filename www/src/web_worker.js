@@ -3,6 +3,10 @@ import {
   createAPI
 } from "./api.js";
 
+// Long enough to make progress, short enough that messages like
+// stop-thinking don't wait behind a deep search
+const thinking_slice_ms = 20;
+
 class State {
   constructor(api) {
     this.api = api;
@@ -31,6 +35,7 @@ class State {
     } else if (action === 'load-dict') {
       this.api.load_dict(msg['allowed_guesses'], msg['possible_secrets'], msg['hard_mode']);
       this.is_thinking = false;
+      await this.load_opening_book();
     } else if (action === 'make-guess') {
       let guess = msg['word'];
       let match = msg['pattern'];
@@ -43,6 +48,12 @@ class State {
         'key': key,
         'id': id,
       });
+    } else if (action === 'load-solutions') {
+      this.send_message({
+        'action': 'load-solutions',
+        'solutions': await this.load_solutions(msg['key']),
+        'id': id,
+      });
     } else if (action === 'back') {
       let did_go_back = this.api.back()
       this.is_thinking = false;
@@ -60,19 +71,54 @@ class State {
     return this.pipe.send_message(msg);
   }
 
+  // Second moves precomputed for the dictionary just loaded, if any
+  async load_opening_book() {
+    let key = this.api.cache_key();
+    let response = await fetch('./cache/' + key + '.book.json', {
+      cache: "no-cache"
+    });
+    if (!response.ok) {
+      return;
+    }
+    try {
+      let size = this.api.load_opening_book(await response.text());
+      console.log("Opening book loaded with", size, "states");
+    } catch (error) {
+      console.log("Failed to load opening book", error);
+    }
+  }
+
+  // Solutions of the current state, from its binary solutions file or else
+  // from the decision trees of the last one loaded
+  async load_solutions(key) {
+    let response = await fetch('./cache/' + key + '.bin', {
+      cache: "no-cache"
+    });
+    if (response.ok) {
+      try {
+        let bytes = new Uint8Array(await response.arrayBuffer());
+        return this.api.load_binary_solutions(bytes);
+      } catch (error) {
+        console.log("Failed to load binary solutions", error);
+      }
+    }
+    let move = this.api.binary_tree_move();
+    return move ? [move] : null;
+  }
+
   async think(id) {
     if (!this.is_thinking || id !== this.thinking_id) {
       return;
     }
 
-    var output;
+    var step;
     try {
-      output = this.api.compute_next_suggestion();
+      step = this.api.compute_next_suggestion(thinking_slice_ms);
     } catch (error) {
       console.error(error);
       return;
     }
-    if (!output) {
+    if (step['done'] === 'true') {
       this.is_thinking = false;
       this.send_message({
         'action': 'stopped-thinking',
@@ -80,11 +126,13 @@ class State {
         'id': this.thinking_id,
       });
     } else {
-      await this.send_message({
-        'action': 'update-think',
-        'update': output,
-        'id': this.thinking_id,
-      });
+      for (let update of step['updates']) {
+        await this.send_message({
+          'action': 'update-think',
+          'update': update,
+          'id': this.thinking_id,
+        });
+      }
       this.schedule_think(id);
     }
   }
@@ -91,6 +91,20 @@ export class WorkerAPI {
     });
   }
 
+  async load_solutions(key) {
+    let id = this._get_id();
+    await this.send_message({
+      "action": "load-solutions",
+      "key": key,
+      "id": id,
+    });
+    return new Promise((resolve) => {
+      this._promises[id] = (msg) => {
+        resolve(msg['solutions']);
+      };
+    });
+  }
+
   _handle_worker_message(msg) {
     let action = msg['action'];
     let id = msg['id'];